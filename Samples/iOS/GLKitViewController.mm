@@ -45,7 +45,6 @@
     // Initialize
     NSString *path = [[NSBundle mainBundle] pathForResource:@"model/wuwangfuchai/profile" ofType:@"txt"];
     myEngine = new LFEngine([path UTF8String]);
-    myEngine->StartFPSThread();
     
     drawFlag = true;
     drawWidth = 0;
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <memory>
+#include <numeric>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -148,10 +149,9 @@ int main(int argc, char **argv)
 
 		// set image data
 		myEngine->RegisterDecFunc(JpegHeaderDecoder, JpegDecoder);
-#pragma omp parallel for
-		for (int i = 0; i < profile.nCams; ++i) {
-			ASSERT(myEngine->SetRefImage(i, profile.imageList[i], 1.f));
-		}
+		vector<size_t> ids(profile.nCams);
+		std::iota(ids.begin(), ids.end(), 0);
+		ASSERT(myEngine->SetRefImages(ids, profile.imageList, 1.f));
 
 		// set scene settings
 		switch (profile.mode)
@@ -173,9 +173,6 @@ int main(int argc, char **argv)
 		// set screen viewport
 		myEngine->Resize(WINDOW_WIDTH, WINDOW_HEIGHT);
 
-		// start background fps counting thread
-		myEngine->StartFPSThread();
-
 		// set background image
 		//ASSERT(myEngine->SetBackground("view.jpg"));
 		myEngine->SetBackground(0.3f, 0.f, 0.f);
@@ -190,10 +187,17 @@ int main(int argc, char **argv)
 			glClearColor(0, 0, 0, 0);
 			glClear(GL_COLOR_BUFFER_BIT);
 
-			myEngine->Draw();
+			const bool rendered = myEngine->Draw();
 
 			glfwSwapBuffers(gWindow);
-			glfwPollEvents();
+
+			// idle until input arrives if the frame did not change
+			if (rendered) {
+				glfwPollEvents();
+			}
+			else {
+				glfwWaitEventsTimeout(0.1);
+			}
 		}
 
 		// release resource
@@ -2,6 +2,7 @@
 #define BOUNDING_BOX_H
 
 #include <cstdint>
+#include <cstddef>
 
 void BoundingBoxCPU(const float *v, const size_t szV, float &xmin, float &xmax,
 	float &ymin, float &ymax, float &zmin, float &zmax);
@@ -0,0 +1,37 @@
+#ifndef CAMERA_RIG_H
+#define CAMERA_RIG_H
+
+#include <vector>
+#include <cstdint>
+
+#include "camera/Intrinsic.hpp"
+#include "camera/Extrinsic.hpp"
+#include "KdTree.h"
+
+// Per-camera data derived from the reference cameras, kept as arrays and 
+// recomputed only when cameras (or the scene center/range) change, so 
+// that per-frame code never inverts view matrices.
+struct CameraRig
+{
+	glm::vec3 center;						// directions are relative to it
+	std::vector<glm::vec3> positions;		// camera centers in world space
+	std::vector<glm::vec3> directions;		// unit vectors from center to cameras
+	std::vector<float> nnSqDists;			// squared distance to nearest camera
+	std::vector<glm::mat4> VPs;				// view-projection matrices
+	KdTree directionTree;					// nearest directions search
+	std::vector<bool> eligible;				// textures are ready for sampling
+
+	CameraRig();
+
+	// positions and nearest neighbour distances, every camera eligible
+	void UpdateCameras(const std::vector<Extrinsic> &extrins);
+
+	// directions from *c* and their search tree
+	void UpdateDirections(const glm::vec3 &c);
+
+	void UpdateProjections(const std::vector<Intrinsic> &intrins,
+		const std::vector<Extrinsic> &extrins, const float near, 
+		const float far, const int width, const int height);
+};
+
+#endif /* CAMERA_RIG_H */
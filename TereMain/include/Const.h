@@ -1,17 +1,87 @@
 #ifndef CONST_H
 #define CONST_H
 
-const int MAX_VERTEX = 1000000;			// maximum vertex size
-const int MAX_FACE = MAX_VERTEX * 2;	// maximum face size
-
 const int BYTES_PER_VERTEX = sizeof(float) * 3;	
 const int BYTES_PER_FACE = sizeof(int) * 3;
 
+// geometry buffers grow by this factor when a larger mesh arrives
+const float GEOMETRY_GROWTH = 1.5f;
+
+// meshes with at most this many vertices are drawn with 16-bit indices
+const int MAX_SHORT_INDEXED_VERTEX = 65536;
+
+// frames taking longer than this multiple of the median count as hitches
+const float HITCH_FACTOR = 2.f;
+
+// interpolation cameras are reused while the view direction stays within 
+// this angle (degrees) of where they were selected
+const float SELECTION_THRESHOLD = 0.5f;
+
+// a newly found camera replaces a selected one only if its cosine distance 
+// is smaller by this fraction
+const float SELECTION_HYSTERESIS = 0.2f;
+
+// with dynamic resolution, the scene pass resolution is scaled by this 
+// factor while the view is being dragged or moves through slots
+const float INTERACTION_SCALE = 0.5f;
+
+// dynamic resolution changes by at least this much, and waits this many 
+// frames after every change for GPU timings to catch up
+const float RESOLUTION_STEP = 0.05f;
+const int RESOLUTION_SETTLE_FRAMES = 4;
+
+// every simplified level of the geometry keeps this fraction of the faces 
+// of the previous one, and levels stop before dropping below this many faces
+const float LOD_REDUCTION = 0.5f;
+const int MIN_LOD_FACES = 64;
+
+// the coarsest level of the geometry whose error stays within this many 
+// pixels on screen is drawn
+const float LOD_PIXEL_ERROR = 1.f;
+
+// faces of the geometry are culled in clusters (meshlets) of this many
+const int MESHLET_FACES = 256;
+
 // maximum number of interpolation cameras
 #ifndef MAX_NUM_INTERP
 #define MAX_NUM_INTERP 10
 #endif
+
+// interpolation cameras are projected per vertex while their clip 
+// coordinates fit in the 15 varying vectors ES 3.0 guarantees along with the
+// others, and per fragment beyond that
+#if MAX_NUM_INTERP <= 12
+#define PROJECT_PER_VERTEX
+#endif
+
+// mip levels kept for reference textures sampled by the scene pass (1 
+// disables mipmapping)
+#ifndef MAX_MIP_LEVELS
+#define MAX_MIP_LEVELS 4
+#endif
+
+// reference cameras in texture arrays have their depth baked this many at a
+// time, by one instanced draw into tiles of an atlas at most BAKE_ATLAS_SIZE 
+// texels wide and high. Larger batches save draw calls but make the atlas
+// spill out of cache on software rasterizers.
+#ifndef MAX_BAKE_BATCH
+#define MAX_BAKE_BATCH 8
+#endif
+const int BAKE_ATLAS_SIZE = 4096;
+
+// depth maps separated from color (USE_DEPTH_MAP) are stored in texture arrays
+#if defined USE_DEPTH_MAP && !defined USE_TEXTURE_ARRAY
+#define USE_TEXTURE_ARRAY
+#endif
+
+// resolution of separated depth maps relative to reference images
+#ifndef DEPTH_MAP_SCALE
+#define DEPTH_MAP_SCALE 0.5f
+#endif
+
 #define STRINGIFY(i) #i
 #define STR_MAX_NUM_INTERP(i) STRINGIFY(i)
+#define STR_DEPTH_MAP_SCALE(i) STRINGIFY(i)
+#define STR_MAX_BAKE_BATCH(i) STRINGIFY(i)
 
 #endif /* CONST_H */
@@ -2,11 +2,19 @@
 #define ERROR_H
 
 #include <sstream>
+#include <stdexcept>
+#include <cstdio>
+
+// the secure CRT functions are MSVC only
+#ifndef _MSC_VER
+#define sprintf_s snprintf
+#define printf_s printf
+#endif
 
 #define THROW_ON_ERROR(...) do {\
-	char temp_msg[4096], temp_err[4096];	\
+	char temp_msg[4096], temp_err[4096 + 512];	\
 	sprintf_s(temp_msg, 4096, __VA_ARGS__);	\
-	sprintf_s(temp_err, 4096, "[ERROR] %s at %s, Line: %d\n", temp_msg, __FILE__, __LINE__);\
+	sprintf_s(temp_err, sizeof(temp_err), "[ERROR] %s at %s, Line: %d\n", temp_msg, __FILE__, __LINE__);\
 	throw std::runtime_error(temp_err);	\
 } while(0)
 
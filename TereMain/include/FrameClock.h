@@ -0,0 +1,39 @@
+#ifndef FRAME_CLOCK_H
+#define FRAME_CLOCK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "Type.h"
+
+// Lock-free record of recent frame timestamps. Tick() is called by the 
+// rendering thread only; Summarize() may run concurrently on any thread and 
+// drops entries that were overwritten while it was reading them.
+class FrameClock
+{
+public:
+	FrameClock();
+	FrameClock(const FrameClock &) = delete;
+	FrameClock& operator=(const FrameClock &) = delete;
+
+	// record the start of a frame
+	void Tick();
+
+	// frame time distribution of frames started within the last *window* 
+	// seconds (at most CAPACITY - 1 frames)
+	FrameTimeStats Summarize(const float window) const;
+
+private:
+	int64_t Now() const;
+
+	enum {
+		CAPACITY = 1024,			// timestamps kept
+	};
+
+	std::chrono::steady_clock::time_point _epoch;
+	std::atomic<int64_t> _stamps[CAPACITY];		// us since _epoch
+	std::atomic<uint64_t> _count;				// timestamps ever recorded
+};
+
+#endif /* FRAME_CLOCK_H */
@@ -9,6 +9,9 @@
 #elif defined PLATFORM_OSX
 	#include <GL/glew.h>
 	#define GL_OSX
+#elif defined PLATFORM_LINUX
+	#include <GL/glew.h>
+	#define GL_LINUX
 #elif defined PLATFORM_IOS
 	#include <OpenGLES/ES3/gl.h>
 	#include <OpenGLES/ES3/glext.h>
@@ -0,0 +1,43 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include "GLHeader.h"
+
+// GL_TIME_ELAPSED queries are core on desktop GL only
+#if defined GL_WIN || defined GL_OSX || defined GL_LINUX
+#define USE_GPU_TIMER
+#endif
+
+// Non-blocking GPU timer. Every Begin()/End() pair uses its own query from a 
+// small ring and results are collected once available, so reading a timer 
+// never stalls. Timers must not be nested.
+class GpuTimer
+{
+public:
+	GpuTimer();
+	~GpuTimer();
+	GpuTimer(const GpuTimer &) = delete;
+	GpuTimer& operator=(const GpuTimer &) = delete;
+
+	void Begin();
+	void End();
+
+	// latest finished measurement (ms), negative if there is none
+	float Elapsed();
+
+private:
+	// fetch results of finished queries
+	void Collect();
+
+	enum {
+		NUM_QUERIES = 4,			// queries in flight
+	};
+
+	GLuint _queries[NUM_QUERIES];
+	size_t _head;					// oldest pending query
+	size_t _count;					// pending queries
+	float _ms;						// latest result
+	bool _created;					// queries have been generated
+};
+
+#endif /* GPU_TIMER_H */
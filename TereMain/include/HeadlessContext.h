@@ -0,0 +1,33 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include "LFEngine.h"
+
+// An OpenGL 3.3 core context without any window or display (Linux only). 
+// It is created on a surfaceless EGL display, so it also works with Mesa's
+// software renderer on render servers. Construction throws on failure and 
+// leaves the context current. A context created with *share* shares objects
+// with it and is not made current, e.g. to serve as loader context
+// (LFEngine::SetLoaderContext) on another thread.
+class HeadlessContext
+{
+public:
+	EXPORT HeadlessContext();
+	EXPORT explicit HeadlessContext(const HeadlessContext *share);
+	EXPORT ~HeadlessContext();
+	HeadlessContext(const HeadlessContext &) = delete;
+	HeadlessContext& operator=(const HeadlessContext &) = delete;
+
+	// make the context current on calling thread
+	EXPORT bool MakeCurrent();
+
+	// make no context current on calling thread
+	EXPORT bool Release();
+
+private:
+	void *_display;		// EGLDisplay
+	void *_context;		// EGLContext
+	bool _shared;		// display is terminated by the shared context
+};
+
+#endif /* HEADLESS_CONTEXT_H */
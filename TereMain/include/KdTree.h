@@ -0,0 +1,43 @@
+#ifndef KD_TREE_H
+#define KD_TREE_H
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+using std::vector;
+
+// Static kd-tree over 3D points, stored as an implicit balanced tree (the
+// root of every subtree sits at the middle of its range).
+class KdTree
+{
+public:
+	void Build(const vector<glm::vec3> &points);
+
+	// up to k nearest points to *q* as (squared distance, point index), 
+	// closest first. Point *exclude* and points not set in *mask* (if given)
+	// are skipped.
+	vector<std::pair<float, size_t>> Nearest(const glm::vec3 &q, 
+		const size_t k, const size_t exclude = SIZE_MAX,
+		const vector<bool> *mask = nullptr) const;
+
+	size_t Size() const { return _ids.size(); }
+
+private:
+	// arrange point indices in [begin, end) into a balanced subtree
+	void Split(const vector<glm::vec3> &points, const size_t begin, 
+		const size_t end, const int axis);
+
+	// collect the k nearest nodes of subtree [begin, end) into max-heap *best*
+	void Query(const size_t begin, const size_t end, const int axis,
+		const glm::vec3 &q, const size_t k, const size_t exclude,
+		const vector<bool> *mask, vector<std::pair<float, size_t>> &best) const;
+
+	vector<glm::vec3> _points;		// points in tree order
+	vector<size_t> _ids;			// point index of every node
+};
+
+#endif /* KD_TREE_H */
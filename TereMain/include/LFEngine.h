@@ -5,14 +5,20 @@
 #include <memory>
 #include <cstdint>
 #include <array>
+#include <vector>
 
 #include "Type.h"
 
+#if defined _MSC_VER
 #define EXPORT __declspec(dllexport)
+#else
+#define EXPORT __attribute__((visibility("default")))
+#endif
 
 using std::string;
 using std::unique_ptr;
 using std::array;
+using std::vector;
 
 class LFEngineImpl;
 
@@ -32,6 +38,18 @@ public:
 	EXPORT bool SetGeometry(const float *v, const size_t szV, const int *f,
 		const size_t szF, bool GPU = false);
 
+	// Simplify indexed geometry into *levels* levels of detail, each with 
+	// half the faces of the previous one, and draw the coarsest one whose 
+	// error stays within a pixel on screen. With *fullDepth*, depth maps are
+	// baked from the full mesh. 1 (default) always draws the full mesh. 
+	// Ignored for geometry in CUDA memory.
+	EXPORT bool SetGeometryLod(const size_t levels, bool fullDepth = true);
+
+	// Skip faces turned away from the viewer (enabled by default). Disable 
+	// for geometry whose faces are not consistently wound counter-clockwise
+	// seen from the front. Geometry outside the view is skipped either way.
+	EXPORT void SetFaceCulling(bool enable);
+
 	// Set image raw data directly
 	EXPORT bool SetRefImage(const size_t id, const uint8_t *rgb, const size_t w,
 		const size_t h);
@@ -41,6 +59,26 @@ public:
 	EXPORT bool SetRefImage(const size_t id, const string &filename,
 		const float zoom = 1.f);
 
+	// Use a caller buffer as image data without copying it. The engine calls
+	// *release* (if given) once it no longer needs the buffer; without 
+	// *release* the buffer is borrowed and must outlive its use by the engine
+	EXPORT bool AdoptRefImage(const size_t id, uint8_t *rgb, const size_t w,
+		const size_t h, ReleaseImageFunc release, void *user = nullptr);
+
+	// Free (or release) host images as soon as their textures are uploaded. 
+	// HaveSetScene() cannot be called again afterwards.
+	EXPORT void SetReleaseAfterUpload(bool release);
+
+	// Set a batch of image files, decoded in parallel by the decoding threads.
+	// A camera listed more than once takes its last file. Ids of images that 
+	// failed are appended to *failed* (if given)
+	EXPORT bool SetRefImages(const vector<size_t> &ids, 
+		const vector<string> &filenames, const float zoom = 1.f,
+		vector<size_t> *failed = nullptr);
+
+	// Set number of image decoding threads (0 means hardware concurrency)
+	EXPORT void SetDecodeThreads(const size_t n);
+
 	// Set camera parameters
 	EXPORT bool SetCamera(const size_t id, const array<float, 9> &K,
 		const array<float, 16> &M, bool w2c, bool yIsUp);
@@ -57,19 +95,51 @@ public:
 	// Inform Tere that data is initialized
 	EXPORT bool HaveSetScene();
 
-	// Inform Tere that data is updated
+	// Inform Tere that data is updated. With a loader context, updated images
+	// are uploaded in the background and their cameras take part in rendering
+	// once ready; cameras or geometry changed along with them are still 
+	// uploaded in place.
 	EXPORT bool HaveUpdatedScene();
 
+	// Give Tere a context shared with the rendering one, used to upload 
+	// images updated after HaveSetScene() without blocking Draw()
+	EXPORT bool SetLoaderContext(LoaderContextFunc bind, void *user = nullptr);
+
+	// Images of the last HaveUpdatedScene() are still being uploaded
+	EXPORT bool IsLoading(void) const;
+
 	/*****************************************************************************
 	 *			Others
 	 ****************************************************************************/
 	// TODO: Other setting funcs in the case of LINEAR and SPHERE mode.
 
-	// Draw one frame
-	EXPORT void Draw(void);
+	// Draw one frame. Returns false if nothing changed since the previous 
+	// frame and it was only presented again (hosts may throttle their loop).
+	EXPORT bool Draw(void);
+
+	// Skip scene rendering for unchanged frames (enabled by default)
+	EXPORT void SetRedrawOnChange(bool enable);
 
-	// Set up an background thread for counting fps
-	EXPORT void StartFPSThread(void);
+	// Reuse interpolation cameras while the view direction stays within 
+	// *degrees* of where they were selected (0 searches every frame)
+	EXPORT void SetSelectionThreshold(float degrees);
+
+	// Prepare the next frame on a worker thread while the current one is 
+	// submitted (enabled by default)
+	EXPORT void SetPipelining(bool enable);
+
+	// Render the scene at a lower resolution when GPU time of a frame exceeds
+	// *targetMs*, down to *minScale* of the reference image size, and lower
+	// it further while the view is being dragged. 0 always renders at full
+	// resolution (default).
+	EXPORT void SetDynamicResolution(float targetMs, float minScale = 0.25f);
+
+	// Render the scene from every pose (K and M as in SetCamera) into an RGBA 
+	// buffer of reference image size, top row first. The interactive camera 
+	// and screen framebuffer are left untouched. Requires HaveSetScene().
+	EXPORT bool RenderPoses(const vector<array<float, 9>> &Ks, 
+		const vector<array<float, 16>> &Ms, bool w2c, bool yIsUp, 
+		vector<vector<uint8_t>> &rgbas);
 
 	// Set view port size
 	EXPORT void Resize(uint32_t width, uint32_t height);
@@ -88,12 +158,31 @@ public:
 
 	// Get FPS (frames drawn in previous second)
 	EXPORT float GetFPS(void) const;
+
+	// Get frame time percentiles and hitches of frames drawn in the previous
+	// *window* seconds. Safe to call from any thread.
+	EXPORT FrameTimeStats GetFrameTimes(const float window = 1.f) const;
+
+	// Get CPU and GPU timings of recent frames (call on the rendering thread)
+	EXPORT FrameStats GetFrameStats(void);
     
 	// Extract a subregion of current frame buffer. 
 	// x and y specifies the lower left corner of this region, 
 	// width and height specifies the dimension of this region
 	EXPORT bool GetScreenShot(unsigned char *buffer, int x, int y, int width, int height) const;
 
+	// Register where asynchronous screenshots are delivered
+	EXPORT void SetScreenShotSink(ScreenShotSinkFunc sink, void *user = nullptr);
+
+	// Queue an asynchronous screenshot of the screen framebuffer's current 
+	// content (region as in GetScreenShot). It reaches the sink a few frames 
+	// later, from Draw() or FlushScreenShots(), without stalling the GPU.
+	EXPORT bool QueueScreenShot(int x, int y, int width, int height);
+
+	// Deliver finished screenshots now. With *wait*, block until all queued
+	// ones are delivered. Returns the number delivered.
+	EXPORT size_t FlushScreenShots(bool wait = false);
+
 	// set background color
 	EXPORT bool SetBackground(float r, float g, float b);
 	// set background image
@@ -5,14 +5,20 @@
 #include <memory>
 #include <queue>
 #include <array>
+#include <functional>
 
 #include "camera/Camera.h"
 #include "Type.h"
 #include "Strategy.h"
+#include "FrameClock.h"
+#include "ResolutionScaler.h"
+#include "WeightedCamera.h"
 
 class Renderer;
-class TextureFuser;
 class Poster;
+class Readback;
+class GpuTimer;
+class Worker;
 class UserInterface;
 struct TereScene;
 
@@ -38,6 +44,18 @@ public:
 	bool SetGeometry(const float *v, const size_t szV, const int *f,
 		const size_t szF, bool GPU = false);
 
+	// Simplify indexed geometry into *levels* levels of detail, each with 
+	// half the faces of the previous one, and draw the coarsest one whose 
+	// error stays within a pixel on screen. With *fullDepth*, depth maps are
+	// baked from the full mesh. 1 (default) always draws the full mesh. 
+	// Ignored for geometry in CUDA memory.
+	bool SetGeometryLod(const size_t levels, bool fullDepth = true);
+
+	// Skip faces turned away from the viewer (enabled by default). Disable 
+	// for geometry whose faces are not consistently wound counter-clockwise
+	// seen from the front. Geometry outside the view is skipped either way.
+	void SetFaceCulling(bool enable);
+
 	// Set image raw data directly
 	bool SetRefImage(const size_t id, const uint8_t *rgb, const size_t w,
 		const size_t h);
@@ -47,6 +65,24 @@ public:
 	bool SetRefImage(const size_t id, const string &filename,
 		const float zoom = 1.f);
 
+	// Use a caller buffer as image data without copying it. The engine calls
+	// *release* (if given) once it no longer needs the buffer; without 
+	// *release* the buffer is borrowed and must outlive its use by the engine
+	bool AdoptRefImage(const size_t id, uint8_t *rgb, const size_t w,
+		const size_t h, ReleaseImageFunc release, void *user = nullptr);
+
+	// Free (or release) host images as soon as their textures are uploaded. 
+	// HaveSetScene() cannot be called again afterwards.
+	void SetReleaseAfterUpload(bool release);
+
+	// Set a batch of image files, decoded in parallel by the decoding threads.
+	// Ids of images that failed are appended to *failed* (if given)
+	bool SetRefImages(const vector<size_t> &ids, const vector<string> &filenames,
+		const float zoom = 1.f, vector<size_t> *failed = nullptr);
+
+	// Set number of image decoding threads (0 means hardware concurrency)
+	void SetDecodeThreads(const size_t n);
+
 	// Set camera parameters
 	bool SetCamera(const size_t id, const array<float, 9> &K, 
 		const array<float, 16> &M, bool w2c, bool yIsUp);
@@ -63,19 +99,51 @@ public:
 	// Inform Tere that data is initialized
 	bool HaveSetScene();
 
-	// Inform Tere that data is updated
+	// Inform Tere that data is updated. With a loader context, updated images
+	// are uploaded in the background and their cameras take part in rendering
+	// once ready; cameras or geometry changed along with them are still 
+	// uploaded in place.
 	bool HaveUpdatedScene();
 
+	// Give Tere a context shared with the rendering one, used to upload 
+	// images updated after HaveSetScene() without blocking Draw()
+	bool SetLoaderContext(LoaderContextFunc bind, void *user = nullptr);
+
+	// Images of the last HaveUpdatedScene() are still being uploaded
+	bool IsLoading(void) const { return _loading; }
+
 	/*****************************************************************************
 	 *			Others
 	 ****************************************************************************/
 	// TODO: Other setting funcs in the case of LINEAR and SPHERE mode.
 
-	// Draw one frame
-	void Draw(void);
+	// Draw one frame. Returns false if nothing changed since the previous 
+	// frame and it was only presented again.
+	bool Draw(void);
+
+	// Skip scene rendering for unchanged frames (enabled by default)
+	void SetRedrawOnChange(bool enable);
+
+	// Reuse interpolation cameras while the view direction stays within 
+	// *degrees* of where they were selected (0 searches every frame)
+	void SetSelectionThreshold(float degrees);
 
-	// Set up an background thread for counting fps
-	void StartFPSThread(void);
+	// Prepare the next frame on a worker thread while the current one is 
+	// submitted (enabled by default)
+	void SetPipelining(bool enable);
+
+	// Render the scene at a lower resolution when GPU time of a frame exceeds
+	// *targetMs*, down to *minScale* of the reference image size, and lower
+	// it further while the view is being dragged. 0 always renders at full
+	// resolution (default).
+	void SetDynamicResolution(float targetMs, float minScale = 0.25f);
+
+	// Render the scene from every pose (K and M as in SetCamera) into an RGBA 
+	// buffer of reference image size, top row first. The interactive camera 
+	// and screen framebuffer are left untouched. Requires HaveSetScene().
+	bool RenderPoses(const vector<array<float, 9>> &Ks, 
+		const vector<array<float, 16>> &Ms, bool w2c, bool yIsUp, 
+		vector<vector<uint8_t>> &rgbas);
 
 	// Set view port size
 	void Resize(uint32_t width, uint32_t height);
@@ -93,13 +161,32 @@ public:
 	float SetZoomScale(float zoom_scale);
 
 	// Get FPS (frames drawn in previous second)
-	float GetFPS(void) const { return _fps; }
+	float GetFPS(void) const { return _clock.Summarize(1.f).fps; }
+
+	// Get frame time percentiles and hitches of frames drawn in the previous
+	// *window* seconds. Safe to call from any thread.
+	FrameTimeStats GetFrameTimes(const float window) const;
+
+	// Get CPU and GPU timings of recent frames (call on the rendering thread)
+	FrameStats GetFrameStats(void);
 
 	// Extract a subregion of current frame buffer. 
 	// x and y specifies the lower left corner of this region, 
 	// width and height specifies the dimension of this region
 	bool GetScreenShot(unsigned char *buffer, int x, int y, int width, int height) const;
 
+	// Register where asynchronous screenshots are delivered
+	void SetScreenShotSink(ScreenShotSinkFunc sink, void *user = nullptr);
+
+	// Queue an asynchronous screenshot of the screen framebuffer's current 
+	// content (region as in GetScreenShot). It reaches the sink a few frames 
+	// later, from Draw() or FlushScreenShots(), without stalling the GPU.
+	bool QueueScreenShot(int x, int y, int width, int height);
+
+	// Deliver finished screenshots now. With *wait*, block until all queued
+	// ones are delivered. Returns the number delivered.
+	size_t FlushScreenShots(bool wait = false);
+
 	// set background color
 	bool SetBackground(float r, float g, float b);
 	// set background image
@@ -110,10 +197,78 @@ public:
 	void SetScreenFBO(unsigned int fbo);
 
 private:
-	void _Draw(void);
+	enum InterpMode
+	{
+		// Set rendering camera to any ref cameras and disable interpolation
+		FIX,
+		// Use interpolation
+		INTERP
+	};
+
+	// Interpolation cameras picked by SelectInterp, which keeps them while 
+	// the view barely moves
+	struct Selection
+	{
+		Selection() : dir(0.f), version(0) {}
+
+		vector<size_t> indices;				// selected cameras, by slot
+		glm::vec3 dir;						// view direction at selection
+		uint64_t version;					// _stateVersion at selection
+	};
+
+	// Everything a frame needs besides GL work, prepared ahead on the worker
+	// thread when the next camera is known
+	struct FrameState
+	{
+		bool valid;
+		uint64_t key;						// PrepareHash() it was prepared for
+		glm::mat4 view;
+		glm::mat4 proj;
+		vector<WeightedCamera> cams;		// interpolation cameras
+		Selection selection;				// becomes _selection once drawn
+		float searchTime;					// ms spent searching cameras
+		float weighTime;					// ms spent weighing cameras
+	};
+
+	// submit a prepared frame
+	void _Draw(const FrameState &state);
+
+	// size the scene pass of the next frame
+	void ScaleResolution();
+
+	// hash of everything PrepareFrame reads for *cam*
+	uint64_t PrepareHash(const Camera &cam) const;
+
+	// hash of everything a frame seen by *cam* depends on
+	uint64_t FrameHash(const Camera &cam) const;
+
+	// select and weigh interpolation cameras for *cam*, starting from the
+	// selection *prev*. Runs on the worker thread, so it reads no state that
+	// may change while a job is pending.
+	void PrepareFrame(const Camera &cam, const InterpMode mode, 
+		const size_t fixRef, const uint64_t version, const Selection &prev,
+		FrameState &state);
+
+	// start preparing the next frame on the worker, from the latest input. 
+	// Skipped while the worker is still busy.
+	void PrepareNext();
+
+	// wait for the worker, before changing anything PrepareFrame reads
+	void Sync();
+
+	// let cameras whose images the loader finished be selected. With *wait*,
+	// block until the loader is done, before changing anything it reads.
+	void PollLoader(bool wait);
+
+	// run *job* for every index below *n* on the decoding threads, the 
+	// calling thread included. Returns the number of threads used.
+	size_t RunDecoders(const size_t n, const std::function<void(size_t)> &job);
+
+	// search interpolation cameras for *extrin*, keeping the previous 
+	// selection *sel* where possible, and update it
+	const vector<size_t> &SelectInterp(const Extrinsic &extrin, 
+		const uint64_t version, const size_t maxn, Selection &sel) const;
 
-	// Background thread for FPS counting
-	void VRFPS(void);
 	
 	// A slot is an internal rendering camera which the client cannot control.
 	// The purpose of slots is to acheive smooth rendering effects during the 
@@ -121,22 +276,21 @@ private:
 	void EnqueueSlots(const Extrinsic &start, const Extrinsic &end);
 
 private:
-	enum InterpMode
-	{
-		// Set rendering camera to any ref cameras and disable interpolation
-		FIX,
-		// Use interpolation
-		INTERP
-	} _mode;
+	InterpMode _mode;
 
 	shared_ptr<TereScene> _scene;		// describe the scene setting and data
 	
 	DecHeaderFunc fdh;						// image header decoding function
 	DecImageFunc fdi;						// image decoding function
+	size_t _decThreads;						// image decoding threads
+	vector<unique_ptr<Worker>> _decoders;	// decoding threads but the caller
 
 	unique_ptr<Renderer> _renderer;			// TERE scene renderer
-	unique_ptr<TextureFuser> _textureFuser;	// background fuser
-	unique_ptr<Poster> _poster;				// render to screen
+	unique_ptr<Poster> _poster;				// blend background, render to screen
+	unique_ptr<Readback> _readback;			// asynchronous screenshots
+	unique_ptr<GpuTimer> _posterTimer;		// times the poster pass
+	ScreenShotSinkFunc _shotSink;			// receives screenshots
+	void *_shotUser;						// user data of _shotSink
 
 	Camera _renderCam;						// rendering camera
 
@@ -149,17 +303,38 @@ private:
 	vector<int> _screenViewport;			// poster's viewport
 	vector<int> _offlineViewport;			// scene and fuser' viewport
 
-	float _fps;								// rendering fps
-	int _frames;							// frames drawn
+	FrameClock _clock;						// timestamps of recent frames
+	ResolutionScaler _scaler;				// dynamic scene resolution
+	bool _dragging;							// the user is dragging the view
 
 	// strategy for searching interpolation cameras
 	shared_ptr<SearchStrategy> _schStrg;
 	// strategy for weighing interpolation cameras
 	shared_ptr<WeighStrategy> _wghStrg;
 
+	Selection _selection;					// selection of the drawn frame
+	float _reselectCos;						// cosine of selection threshold
+
 	bool _locked;							// Tere is rendering internal slots
 	float _SLOT_MULTIPLIER;					// slot multiplier
 	std::deque<Extrinsic> _slotQueue;		// slots queue
+
+	bool _redrawOnChange;					// skip unchanged frames
+	bool _frameValid;						// a frame has been rendered
+	uint64_t _frameHash;					// FrameHash() of last rendered frame
+	uint64_t _stateVersion;					// bumped on scene/background change
+
+	unique_ptr<Worker> _worker;				// prepares upcoming frames
+	bool _pipelining;						// use _worker
+	FrameState _frameStates[2];				// submitted and upcoming frame
+	int _front;								// submitted one of _frameStates
+
+	LoaderContextFunc _loaderBind;			// binds the loader context
+	void *_loaderUser;						// user data of _loaderBind
+	bool _loading;							// renderer's loader is busy
+
+	FrameStats _stats;						// timings of recent frames
+	float _slotTime;						// slot work since the last frame
 };
 
 #endif /* LFENGINEIMPL_H */
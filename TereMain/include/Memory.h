@@ -1,6 +1,9 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 
+#include <cstring>
+#include <stdexcept>
+
 #define MEMCPY_HOST2HOST	0
 #define MEMCPY_HOST2DEV		1
 #define MEMCPY_DEV2HOST		2
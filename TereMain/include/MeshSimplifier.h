@@ -0,0 +1,31 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <vector>
+#include <cstddef>
+
+using std::vector;
+
+// Range of one level of detail in the element buffer and the geometric
+// error (in mesh units) it was simplified with
+struct MeshLod
+{
+	size_t first;			// first index
+	size_t count;			// number of indices
+	float error;			// 0 for the full mesh
+	size_t firstMeshlet;	// first meshlet covering the level
+	size_t nMeshlets;		// number of meshlets (0 if it was not clustered)
+};
+
+// Simplify indexed triangles *f* over *nVerts* vertices *v* (xyz floats) by
+// collapsing edges in order of quadric error. The remaining faces are copied
+// to levels[k] once at most targets[k] (decreasing) indices are left, or no 
+// collapse keeps every face facing the same way, along with the largest 
+// error (in mesh units) a collapse introduced so far in errors[k]. 
+// Collapses only move one vertex onto another, so every level references 
+// the vertices of *v* and can share the same vertex buffer.
+void SimplifyMesh(const float *v, const size_t nVerts, const int *f,
+	const size_t nIndices, const vector<size_t> &targets, 
+	vector<vector<int>> &levels, vector<float> &errors);
+
+#endif /* MESH_SIMPLIFIER_H */
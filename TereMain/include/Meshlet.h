@@ -0,0 +1,38 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <vector>
+#include <cstddef>
+
+#include "glm/glm.hpp"
+
+using std::vector;
+
+// Cluster of consecutive faces in the element buffer with the bounds it is
+// culled by
+struct Meshlet
+{
+	size_t first;			// first index
+	size_t count;			// number of indices
+	glm::vec3 center;		// bounding sphere center
+	float radius;			// bounding sphere radius
+	glm::vec3 axis;			// axis of the cone holding every face normal
+	float cutoff;			// sine of the cone's half angle (2 if wider than 90 degrees)
+};
+
+// Reorder the faces of *f* into spatially coherent clusters of up to
+// MESHLET_FACES faces facing about the same way, and append the clusters to
+// *meshlets*. *first* is the offset of *f* in the element buffer.
+void BuildMeshlets(const float *v, int *f, const size_t nIndices,
+	const size_t first, vector<Meshlet> &meshlets);
+
+// planes (xyz inward normal, w offset) bounding the clip volume of *MVP*, in
+// the space MVP transforms from
+void FrustumPlanes(const glm::mat4 &MVP, glm::vec4 planes[6]);
+
+// false if *m* lies outside *planes* or, with *backface*, every face of it
+// turns away from *eye*
+bool MeshletVisible(const Meshlet &m, const glm::vec4 planes[6],
+	const glm::vec3 &eye, const bool backface);
+
+#endif /* MESHLET_H */
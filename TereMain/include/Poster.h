@@ -3,6 +3,8 @@
 
 #include <vector>
 
+#include "image/Image.hpp"
+
 using std::vector;
 
 class Poster
@@ -17,11 +19,20 @@ public:
 	// set texture to render
 	bool SetTexture(unsigned int texture);
 
+	// render only the lower left *sx* x *sy* part of the texture (a scene 
+	// rendered at reduced resolution), upsampled bilinearly
+	void SetRegion(const float sx, const float sy);
+
+	// set background color (blended where texture is transparent)
+	bool SetBackground(const float r, const float g, const float b);
+	bool SetBackground(const Image &);
+
 	// render method
 	bool Render(const vector<int> &viewport) const;
     
     // set screen framebuffer
     void SetScreenFBO(unsigned int fbo);
+	unsigned int ScreenFBO() const { return _fbo; }
 	
 private:
 	bool IsConsistent() const;
@@ -29,6 +40,13 @@ private:
 
 	// the texture to be rendered
 	unsigned int _texture;
+	float _regionX, _regionY;
+	unsigned int _linearSampler;
+
+	// background
+	bool _monochromatic;
+	unsigned int _bgTexture;
+	float _bgR, _bgG, _bgB;
 
 	// shader program
 	unsigned int _program;
@@ -38,8 +56,12 @@ private:
 	unsigned int _vertexBuffer;
 	unsigned int _elementBuffer;
 
-	// texture location
+	// attrib/uniform location
 	int _imageLocation;
+	int _bgColorLocation;
+	int _bgTextureLocation;
+	int _monochromaticLocation;
+	int _regionLocation;
 	    
     // where to render
     unsigned int _fbo;
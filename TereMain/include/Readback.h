@@ -0,0 +1,52 @@
+#ifndef READBACK_H
+#define READBACK_H
+
+#include <cstdint>
+
+#include "GLHeader.h"
+#include "Type.h"
+
+// Asynchronous framebuffer readback. Reads are queued into a ring of pixel 
+// pack buffers and handed out once their fence has signaled, so capturing 
+// does not stall the pipeline.
+class Readback
+{
+public:
+	Readback();
+	~Readback();
+	Readback(const Readback &) = delete;
+	Readback& operator=(const Readback &) = delete;
+
+	// queue a read of a region of *fbo*. If every buffer is still in flight 
+	// the oldest one is waited for and delivered to *sink* first.
+	bool Queue(unsigned int fbo, int x, int y, int width, int height,
+		ScreenShotSinkFunc sink, void *user);
+
+	// deliver finished reads to *sink* in queuing order. With *wait*, block
+	// until every queued read is delivered. Returns the number delivered.
+	size_t Poll(ScreenShotSinkFunc sink, void *user, bool wait);
+
+private:
+	enum {
+		NUM_SLOTS = 3,				// reads in flight
+	};
+
+	struct Slot
+	{
+		GLuint pbo;					// pixel pack buffer
+		size_t size;				// allocated bytes of pbo
+		GLsync fence;				// signaled when the read has landed
+		int width, height;			// region size
+		uint64_t id;				// sequence number
+	};
+
+	// map the oldest slot, hand it to sink and release it
+	void Deliver(ScreenShotSinkFunc sink, void *user);
+
+	Slot _slots[NUM_SLOTS];
+	size_t _head;					// oldest queued slot
+	size_t _count;					// queued slots
+	uint64_t _nextId;				// sequence number of next read
+};
+
+#endif /* READBACK_H */
@@ -2,6 +2,7 @@
 #define RENDERUTILS_H
 
 #include <cstdint>
+#include <cstddef>
 
 // compile vertex, fragment shaders
 unsigned int LoadShaders(const char * vs_code, const char * frag_code);
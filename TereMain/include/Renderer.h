@@ -4,12 +4,16 @@
 #include <string>
 #include <thread>
 #include <memory>
+#include <atomic>
+#include <chrono>
 
 #include "glm/glm.hpp"
 #include "WeightedCamera.h"
 #include "GLHeader.h"
 #include "TereScene.h"
 #include "Const.h"
+#include "Type.h"
+#include "GpuTimer.h"
 
 #ifdef USE_CUDA
 #include "cuda_gl_interop.h"
@@ -18,6 +22,9 @@
 using std::vector;
 using std::string;
 using std::shared_ptr;
+using std::unique_ptr;
+
+class Worker;
 
 class Renderer
 {
@@ -31,6 +38,22 @@ public:
 	// Inform updated images in _scene
 	bool UpdatedLF();
 
+	// Upload images and bake their depth on a loader thread, in the context
+	// *bind* makes current there (sharing objects with the current one)
+	bool StartLoader(LoaderContextFunc bind, void *user);
+
+	// Inform updated images in _scene and upload them on the loader thread.
+	// Returns false, leaving them to UpdatedLF(), without a loader or while 
+	// other depth maps are stale. Ids of the images are stored in *ids*.
+	bool LoadLF(vector<size_t> &ids);
+
+	// Returns true with the ids of the last LoadLF() once their textures can 
+	// be sampled. With *wait*, blocks until then.
+	bool PollLoader(vector<size_t> &ids, bool wait);
+
+	// Inform updated camera parameters (or near/far range) in _scene
+	bool UpdatedCameras();
+
 	// render method
 	int Render(const vector<int> &viewport);
 
@@ -41,47 +64,132 @@ public:
 	// set virtual camera 
 	void SetViewer(const glm::mat4 &M, const glm::mat4 &V, const glm::mat4 &P);
 
+	// throughput of the latest reference image upload (MB/s)
+	float UploadThroughput() const { return _uploadMBps; }
+
+	// GPU time of the latest finished depth baking / scene pass (ms)
+	float DepthPassTime() { return _depthTimer.Elapsed(); }
+	float ScenePassTime() { return _sceneTimer.Elapsed(); }
+
 private:
+	// copy image in bound PBO to id-th camera's texture
+	void UploadImage(const size_t id);
+
+	// copy dirty images of _scene to their textures, storing their ids
+	bool UploadImages(vector<size_t> &ids);
+
+	// update the upload throughput once the pending uploads have landed,
+	// without waiting for them
+	void CollectUploadTime();
+
 	bool RefreshDepth();
 
+	// render depth of cameras *ids* with VAO and framebuffers of the calling 
+	// thread's context. Texture array builds draw batches of cameras into the
+	// tiles of *atlasFbo* and copy them out to their layers.
+#ifdef USE_TEXTURE_ARRAY
+	bool BakeDepth(const vector<size_t> &ids, GLuint vao, GLuint fbo, 
+		GLuint atlasFbo);
+#else
+	bool BakeDepth(const vector<size_t> &ids, GLuint vao, GLuint fbo);
+#endif
+
+	// coarsest level of detail whose error stays within LOD_PIXEL_ERROR 
+	// pixels when the mesh is seen with *MV* and *P* at *height* pixels
+	size_t PickLod(const glm::mat4 &MV, const glm::mat4 &P, const int height) const;
+
+	// draw the bound VAO's geometry at a level of detail, *instances* times
+	void DrawGeometry(const size_t level, const GLsizei instances = 1) const;
+
+	// draw the meshlets of a level that can be seen with *MV* and *P*
+	void DrawVisible(const size_t level, const glm::mat4 &MV, const glm::mat4 &P);
+
+	// downsample id-th camera's sampled textures into their mip levels
+	void BuildMips(const size_t id, GLuint vao, GLuint fbo);
+
+	// release the loader thread and its context
+	void StopLoader();
+
 private:
 	enum {
 		FRAMEBUFFER_WIDTH = 1024,	// width of rendered texture
 		FRAME_BUFFER_HEIGHT = 1024,	// height of rendered texture
 		NUM_INTERP = MAX_NUM_INTERP,	// maximum interp camera counts
+		CAMERA_UBO_BINDING = 0,		// binding point of InterpCameras block
+		BAKE_UBO_BINDING = 1,		// binding point of BakeCameras block
+		NUM_PBO = 3,				// PBOs in the image upload ring
 	};
 
 	shared_ptr<TereScene> _scene;
 
 	GLuint _sceneShader;			// shader for multi-view rendering
 	GLuint _depthShader;			// shader for depth rendering
+	GLuint _mipShader;				// shader for mip level downsampling
+	GLuint _mipSampler;				// reads single levels while building mips
 
-	GLuint _VPTexture;				// view-proj mats are stored as texture
-	GLuint _VTexture;				// view mats are stored as texture
+	GLuint _camUBO;					// interp cameras' VP of current frame
 
 	/* depth shader uniform locations */
-	GLint _dVPLct;					// view-proj matrix of render cam
 	GLint _dNearLct;				// near
 	GLint _dFarLct;					// far
+#ifdef USE_TEXTURE_ARRAY
+	GLint _dTileScaleLct;			// size of a tile in atlas NDC
+#else
+	GLint _dVPLct;					// view-proj matrix of render cam
+#endif
+
+	/* mip shader uniform locations */
+	GLint _mSourceLct;				// texture being downsampled
+	GLint _mLevelLct;				// level read from
+#ifdef USE_TEXTURE_ARRAY
+	GLint _mLayerLct;				// layer of texture array
+#endif
+#ifdef USE_DEPTH_MAP
+	GLint _mDepthPassLct;			// downsampling a depth map
+#endif
 
 	/* scene shader uniform locations */
 	GLint _sNearLct;				// near 
 	GLint _sFarLct;					// far 
-	GLint _sNCamLct;				// number of reference cameras
 	GLuint _sVPLct;					// view-proj matrix of render cam
-	GLint _sVPRefLct;				// view-proj matices texture
-	GLint _sVRefLct;				// view matrices texture
 	GLint _sNInterpLct;				// number of interpolation cameras
 	GLint _sItpIdLct[NUM_INTERP];	// indices of interpolation cameras
 	GLint _sItpWtLct[NUM_INTERP];	// weights of interpolation cameras
+	GLint _sMaxLodLct;				// last mip level of the light field
+#ifdef USE_DEPTH_MAP
+	GLint _sDepthLct;				// depth map texture array
+	GLint _sDepthMaxLodLct;			// last mip level of depth maps
+#endif
+#ifdef USE_TEXTURE_ARRAY
+	GLint _sLFLct;					// light field texture array
+#else
 	GLint _sLFLct[NUM_INTERP];		// light field texture
+#endif
 
 	glm::mat4 _model;				// model mat of render camera
 	glm::mat4 _view;				// view mat of render camera
 	glm::mat4 _proj;				// projection mat of render camera
 
+	float _near;					// near plane ref cameras are computed with
+	float _far;						// far plane ref cameras are computed with
+
+	vector<glm::mat4> _refV;		// view mat of each ref camera
+	vector<glm::mat4> _refVP;		// view-proj mat of each ref camera
+
+	int _mipLevels;					// levels of sampled reference textures
+#if defined USE_DEPTH_MAP
+	GLuint _rgbArray;				// each ref camera has a layer
+	GLuint _depthArray;				// linear depth (DEPTH_MAP_SCALE resolution)
+	int _depthW;					// depth map width
+	int _depthH;					// depth map height
+	int _depthLevels;				// levels of depth maps
+#elif defined USE_TEXTURE_ARRAY
+	GLuint _rgbArray;				// each ref camera has a layer
+	GLuint _rgbdArray;				// rgb texture + depth
+#else
 	vector<GLuint> _rgbTextures;	// each ref camera has a texture
 	vector<GLuint> _rgbdTextures;	// rgb texture + depth
+#endif
 									
 	GLuint _fbo;					// scene's frame buffer
 	GLuint _dAttach;				// scene's depth attachment
@@ -90,23 +198,64 @@ private:
 	GLuint _rgbdFbo;				// depth's frame buffer
 	GLuint _rgbdDAttach;			// depth's depth attachment
 
+#ifdef USE_TEXTURE_ARRAY
+	GLuint _atlasFbo;				// bake atlas' frame buffer
+	GLuint _atlasCAttach;			// bake atlas' color attachment
+	GLuint _atlasDAttach;			// bake atlas' depth attachment
+	GLuint _bakeUBO;				// VP and tile of each camera in a bake batch
+	int _tileW;						// width of a camera's tile
+	int _tileH;						// height of a camera's tile
+	int _tileCols;					// tiles per atlas row
+	int _tileRows;					// tiles per atlas column
+	size_t _batchSize;				// cameras baked per draw
+#endif
+
 	vector<size_t> indexSizes;		// index count in each object
 	
 	GLuint _VAO;					// VAO
 	GLuint _posBuffer;				// vertex position buffer
 	//GLuint _clrBuffer;			// vertex color buffer
 	GLuint _elmBuffer;				// element buffer
-	GLuint _PBO;					// PBO (for unpacking to texture)
+	size_t _szPosBuffer;			// allocated bytes of _posBuffer
+	size_t _szElmBuffer;			// allocated bytes of _elmBuffer
+	GLenum _elmType;				// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	vector<MeshLod> _lods;			// levels of detail in _elmBuffer
+	vector<Meshlet> _meshlets;		// clusters of faces of _lods
+	vector<GLsizei> _drawCounts;	// index counts of visible meshlet runs
+	vector<const void*> _drawOffsets;	// offsets of visible meshlet runs
+	GLuint _PBO[NUM_PBO];			// PBO ring (for unpacking to texture)
+	GLsync _PBOFence[NUM_PBO];		// signaled when a PBO can be reused
+	std::atomic<float> _uploadMBps;	// latest image upload throughput
+	GLsync _uploadFence;			// signaled once pending uploads landed
+	size_t _uploadBytes;			// bytes of pending uploads
+	std::chrono::high_resolution_clock::time_point _uploadStart;	// when they began
 
 #ifdef USE_CUDA
 	cudaGraphicsResource* _cuPosBuffer;	// cuda resource bound on _posBuffer
 	cudaGraphicsResource* _cuElmBuffer;	// cuda resource bound on _elmBuffer
-	cudaGraphicsResource* _cuPBO;		// cuda resource bound on _PBO
+	cudaGraphicsResource* _cuPBO;		// cuda resource bound on _PBO[0]
 #endif
 
+	GpuTimer _depthTimer;			// times depth baking
+	GpuTimer _sceneTimer;			// times scene pass
+
 	bool _refreshDepth;				// require updating depth
+	vector<bool> _staleDepth;		// per-camera depth requires re-baking
 
 	vector<WeightedCamera> _interpCams;	// interpolation cameras
+	vector<WeightedCamera> _setInterpCams;	// cameras in uniforms and _camUBO
+	bool _staleInterp;				// uniforms must be sent again
+
+	unique_ptr<Worker> _loader;		// uploads images in the background
+	LoaderContextFunc _loaderBind;	// binds the loader context
+	void *_loaderUser;				// user data of _loaderBind
+	GLuint _loaderVAO;				// VAOs are not shared between contexts,
+	GLuint _loaderFbo;				// neither are framebuffers
+#ifdef USE_TEXTURE_ARRAY
+	GLuint _loaderAtlasFbo;			// bake atlas' frame buffer of the loader
+#endif
+	vector<size_t> _loadingIds;		// images the loader is working on
+	GLsync _loadFence;				// signaled once _loadingIds are ready
 };
 
 #endif /* RENDERER_H */
@@ -0,0 +1,33 @@
+#ifndef RESOLUTION_SCALER_H
+#define RESOLUTION_SCALER_H
+
+// Picks the resolution of the scene pass, as a scale of both dimensions, 
+// from the GPU time of recent frames so that frames stay within a time 
+// budget. The resolution drops further while the view is being dragged.
+class ResolutionScaler
+{
+public:
+	ResolutionScaler();
+
+	// frame time budget (ms) and smallest scale. A budget of 0 disables 
+	// scaling, every frame is rendered at full resolution.
+	void SetBudget(const float ms, const float minScale);
+
+	bool Enabled() const { return _budget > 0.f; }
+
+	// scale to render the next frame with
+	float Next(const bool interacting);
+
+	// GPU time (ms) of a frame rendered at the latest Next() scale. Only 
+	// *sceneMs* depends on the resolution.
+	void Measured(const float sceneMs, const float fixedMs);
+
+private:
+	float _budget;			// frame time budget (ms), 0 if disabled
+	float _minScale;		// smallest scale
+	float _scale;			// scale meeting the budget
+	float _applied;			// scale of the latest frame
+	int _settle;			// frames until measurements reflect _applied
+};
+
+#endif /* RESOLUTION_SCALER_H */
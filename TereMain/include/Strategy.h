@@ -3,6 +3,7 @@
 
 #include <vector>
 #include "camera/Extrinsic.hpp"
+#include "CameraRig.h"
 
 using std::vector;
 
@@ -14,20 +15,20 @@ class SearchStrategy
 public:
 	virtual ~SearchStrategy() {};
 
-	virtual vector<size_t> Search(const vector<Extrinsic> &refs, 
+	virtual vector<size_t> Search(const CameraRig &rig, 
 		const Extrinsic &rcam, const size_t maxn) = 0;
 };
 
-class DefaultSearchStrategy : public SearchStrategy
+// Eligible cameras whose directions have the largest cosine to the view, 
+// answered by the rig's kd-tree over camera directions. Nearest directions
+// by euclidean distance are the ones with the largest cosine.
+class KdSearchStrategy : public SearchStrategy
 {
 public:
-	DefaultSearchStrategy(const glm::vec3 &center);
+	KdSearchStrategy();
 
-	virtual vector<size_t> Search(const vector<Extrinsic> &refs,
+	virtual vector<size_t> Search(const CameraRig &rig,
 		const Extrinsic &rcam, const size_t maxn) override;
-
-private:
-	glm::vec3 _center;
 };
 
 class AllSearchStrategy : public SearchStrategy
@@ -35,7 +36,7 @@ class AllSearchStrategy : public SearchStrategy
 public:
 	AllSearchStrategy();
 
-	virtual vector<size_t> Search(const vector<Extrinsic> &refs,
+	virtual vector<size_t> Search(const CameraRig &rig,
 		const Extrinsic &rcam, const size_t maxn) override;
 };
 
@@ -47,20 +48,17 @@ class WeighStrategy
 public:
 	virtual ~WeighStrategy() {};
 
-	virtual vector<float> Weigh(const std::vector<Extrinsic> &ref,
+	virtual vector<float> Weigh(const CameraRig &rig,
 		const Extrinsic &rcam, const std::vector<size_t> &indices) = 0;
 };
 
 class DefaultWeighStrategy : public WeighStrategy
 {
 public:
-	DefaultWeighStrategy(const glm::vec3 &center);
+	DefaultWeighStrategy();
 
-	virtual vector<float> Weigh(const std::vector<Extrinsic> &ref,
+	virtual vector<float> Weigh(const CameraRig &rig,
 		const Extrinsic &rcam, const std::vector<size_t> &indices) override;
-
-private:
-	glm::vec3 _center;
 };
 
 #endif /* STRATEGY_H */
@@ -7,6 +7,9 @@
 #include "Type.h"
 #include "camera/Intrinsic.hpp"
 #include "camera/Extrinsic.hpp"
+#include "CameraRig.h"
+#include "MeshSimplifier.h"
+#include "Meshlet.h"
 
 /* Describe the setting of the scene */
 struct TereScene
@@ -34,6 +37,15 @@ struct TereScene
 	// Used in ALL and SPHERE mode
 	glm::vec3 center;				// mesh bounding box center
 	float radius;					// average distance from center to cameras
+	float boxRadius;				// half diagonal of mesh bounding box
+
+	// levels of detail built for indexed CPU geometry (1 disables)
+	size_t lodLevels;
+	bool lodFullDepth;				// bake depth maps from the full mesh
+
+	// faces are wound counter-clockwise seen from the front, so back faces 
+	// can be culled
+	bool cullFaces;
 
 	/**************************************************************************
 	*							Scene data
@@ -42,7 +54,7 @@ struct TereScene
 	// vertex buffer
 	float *v;
 
-	// vertex buffer size
+	// vertex buffer size (grows with the geometry)
 	size_t szVBuf;
 
 	// in-use vertex buffer size
@@ -51,12 +63,22 @@ struct TereScene
 	// face buffer
 	int *f;
 
-	// face buffer size
+	// face buffer size (grows with the geometry)
 	size_t szFBuf;
 
 	// in-use face buffer size
 	size_t szF;
 
+	// faces of simplified levels, back to back after those of f
+	std::vector< int > lodF;
+
+	// index range of every level of detail, the full mesh first (empty for
+	// unindexed geometry)
+	std::vector< MeshLod > lods;
+
+	// clusters of the faces of every level, culled together
+	std::vector< Meshlet > meshlets;
+
 	// indicate memory location of geometry (either CUDA or CPU)
 	bool GPU;
 
@@ -64,29 +86,83 @@ struct TereScene
 	std::vector< Intrinsic > intrins;
 	std::vector< Extrinsic > extrins;
 
+	// data derived from camera parameters, refreshed by Configure()
+	CameraRig rig;
+
 	// reference image data
 	int width;
 	int height;
 	std::vector< uint8_t* > rgbs;
 
+	// ownership of reference images. Images allocated by the scene are freed
+	// by it, adopted ones are handed to their release function (borrowed ones
+	// have none and are never freed by the scene)
+	std::vector< bool > ownImages;				// rgbs[id] allocated by scene
+	std::vector< ReleaseImageFunc > releaseFuncs;	// release of adopted rgbs[id]
+	std::vector< void* > releaseData;			// user data of releaseFuncs[id]
+
+	// drop host images once the renderer has uploaded them
+	bool releaseAfterUpload;
+	std::vector< bool > uploadedImages;			// rgbs[id] is in GPU textures
+
+	/**************************************************************************
+	*							Dirty flags
+	*	Set by Update*() and cleared by the renderer once uploaded.
+	*************************************************************************/
+
+	bool dirtyGeometry;				// vertices or faces changed
+	std::vector< bool > dirtyImages;	// per-camera reference image changed
+	std::vector< bool > dirtyCameras;	// per-camera parameters changed
+
 	/**************************************************************************
 	*							Methods
 	*************************************************************************/
 	TereScene();
 	TereScene(const size_t n);
+	~TereScene();
 	TereScene(const TereScene&) = delete;
 	TereScene& operator=(const TereScene&) = delete;
 
 	bool UpdateGeometry(const float *v, const size_t szV, const int *f,
 		const size_t szF, bool GPU);
 
+	// (Re)build lodF and lods from the current geometry
+	bool BuildLods();
+
+	// Reorder the faces of every level into meshlets (after BuildLods())
+	bool BuildMeshlets();
+
 	bool UpdateImage(const size_t id, const uint8_t *data, const int w,
 		const int h);
 
+	// Validate the size of image id, the first image sets the scene's size
+	// (not thread safe)
+	bool CheckImage(const size_t id, const int w, const int h);
+
+	// Validate image size and allocate rgbs[id] without writing it, so that
+	// the buffer can be filled in place (not thread safe)
+	bool ReserveImage(const size_t id, const int w, const int h);
+
+	// Make *data* image id, owned by the scene from now on. It must come 
+	// from new[] (cudaMalloc in CUDA builds).
+	bool TakeImage(const size_t id, uint8_t *data, const int w, const int h);
+
+	// Use *data* as image id without copying. *release* (if any) is called
+	// when the scene no longer needs it. In CUDA builds *data* must be 
+	// device memory.
+	bool AdoptImage(const size_t id, uint8_t *data, const int w, const int h,
+		ReleaseImageFunc release, void *user);
+
+	// Free or hand back image id, leaving rgbs[id] empty
+	void ReleaseImage(const size_t id);
+
 	bool UpdateCamera(const size_t id, const std::array<float, 9> &K, 
 		const std::array<float, 16> &M, bool w2c, bool yIsUp);
 
 	bool Configure();
+
+	// Flag all scene data as changed (e.g. for a newly created renderer)
+	void MarkDirty();
 };
 
 #endif /* TERE_SCENE_H */
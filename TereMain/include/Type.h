@@ -2,6 +2,7 @@
 #define TYPE_H
 
 #include <vector>
+#include <cstdint>
 
 enum UIType : unsigned int
 {
@@ -25,4 +26,48 @@ typedef bool(*DecHeaderFunc)(const char *file, int *width, int *height);
 typedef bool(*DecImageFunc)(const char *file, const int outWidth, 
 	const int outHeight, void *buf, const size_t sz);
 
+// Give an adopted image buffer back to its owner (*user* is passed through
+// unchanged from the adopting call)
+typedef void(*ReleaseImageFunc)(uint8_t *buf, void *user);
+
+// Receive an asynchronous screenshot. *rgba* (bottom row first, as 
+// glReadPixels) is only valid during the call. *id* is the screenshot's 
+// sequence number, counted from 0 in queuing order.
+typedef void(*ScreenShotSinkFunc)(const uint8_t *rgba, const int width,
+	const int height, const uint64_t id, void *user);
+
+// Make a context sharing objects with the rendering context current on the 
+// calling thread (*bind*), or release it again (!*bind*). Called on the 
+// engine's loader thread only.
+typedef bool(*LoaderContextFunc)(bool bind, void *user);
+
+// Timings of recent frames in milliseconds. GPU timings are collected without
+// stalling and lag a few frames behind; they are negative where unavailable
+// (no timer queries on GLES, or the pass has not run yet).
+struct FrameStats
+{
+	float gpuDepth;			// depth baking (only runs when the scene changed)
+	float gpuScene;			// scene pass
+	float gpuPoster;		// background blending and screen pass
+	float cpuSlot;			// advancing through slots
+	float cpuSearch;		// searching interpolation cameras
+	float cpuWeigh;			// weighing interpolation cameras
+	float cpuDraw;			// whole Draw() call
+	float renderScale;		// scene pass resolution relative to full
+	bool rendered;			// scene was rendered, not just presented again
+	bool prepared;			// search and weighing ran ahead on the worker thread
+};
+
+// Distribution of frame times (ms, between the starts of consecutive Draw() 
+// calls) over a sliding window
+struct FrameTimeStats
+{
+	float p50;				// median frame time
+	float p95;
+	float p99;
+	float fps;				// average frame rate
+	uint32_t frames;		// frames measured
+	uint32_t hitches;		// frames longer than HITCH_FACTOR x median
+};
+
 #endif /* TYPE_H */
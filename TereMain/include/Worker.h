@@ -0,0 +1,37 @@
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// A background thread running one job at a time
+class Worker
+{
+public:
+	Worker();
+	~Worker();
+	Worker(const Worker &) = delete;
+	Worker& operator=(const Worker &) = delete;
+
+	// run *job* on the worker thread, after the previous job has finished
+	void Submit(std::function<void()> job);
+
+	// block until the submitted job has finished
+	void Wait();
+
+	// a submitted job has not finished yet
+	bool Busy();
+
+private:
+	void Run();
+
+	std::thread _thread;
+	std::mutex _mutex;
+	std::condition_variable _cond;
+	std::function<void()> _job;		// pending or running job
+	bool _quit;						// worker thread should exit
+};
+
+#endif /* WORKER_H */
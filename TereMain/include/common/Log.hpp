@@ -6,7 +6,7 @@
 #include "Platform.h"
 
 /* LOG function */
-#if defined PLATFORM_WIN ||defined PLATFORM_IPHONE ||defined PLATFORM_OSX
+#if defined PLATFORM_WIN ||defined PLATFORM_IPHONE ||defined PLATFORM_OSX ||defined PLATFORM_LINUX
 #include <cstdio>
 #define LOGI(...) fprintf(stdout, __VA_ARGS__)
 #define vLOGI(format, arg_list) vprintf(format, arg_list)
@@ -6,7 +6,7 @@
 #include <list>
 
 #include "ArcballUI.h"
-#include "Arcball.h"
+#include "ArcBall.h"
 
 using namespace std;
 
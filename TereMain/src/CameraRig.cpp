@@ -0,0 +1,53 @@
+#include <limits>
+
+#include "CameraRig.h"
+
+using namespace std;
+
+CameraRig::CameraRig()
+	: center(0.f)
+{}
+
+void CameraRig::UpdateCameras(const vector<Extrinsic> &extrins)
+{
+	const size_t N = extrins.size();
+
+	positions.resize(N);
+	for (size_t i = 0; i < N; ++i) {
+		positions[i] = extrins[i].Pos();
+	}
+
+	// nearest neighbour of every camera
+	KdTree positionTree;
+	positionTree.Build(positions);
+
+	nnSqDists.resize(N);
+	for (size_t i = 0; i < N; ++i) {
+		const auto nn = positionTree.Nearest(positions[i], 1, i);
+		nnSqDists[i] = nn.empty() ? numeric_limits<float>::max() : nn[0].first;
+	}
+
+	eligible.assign(N, true);
+}
+
+void CameraRig::UpdateDirections(const glm::vec3 &c)
+{
+	center = c;
+
+	directions.resize(positions.size());
+	for (size_t i = 0; i < positions.size(); ++i) {
+		directions[i] = glm::normalize(positions[i] - center);
+	}
+
+	directionTree.Build(directions);
+}
+
+void CameraRig::UpdateProjections(const vector<Intrinsic> &intrins,
+	const vector<Extrinsic> &extrins, const float near, const float far,
+	const int width, const int height)
+{
+	VPs.resize(extrins.size());
+	for (size_t i = 0; i < extrins.size(); ++i) {
+		VPs[i] = intrins[i].ProjMat(near, far, width, height) * extrins[i].viewMat;
+	}
+}
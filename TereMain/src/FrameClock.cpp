@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <vector>
+
+#include "FrameClock.h"
+#include "Const.h"
+
+using namespace std;
+
+// nearest-rank percentile of sorted values
+static float Percentile(const vector<float> &sorted, const float p)
+{
+	const size_t rank = static_cast<size_t>(p * (sorted.size() - 1) + 0.5f);
+	return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+FrameClock::FrameClock()
+	: _epoch(chrono::steady_clock::now()),
+	_count(0)
+{
+	for (auto &stamp : _stamps) {
+		stamp.store(0, memory_order_relaxed);
+	}
+}
+
+int64_t FrameClock::Now() const
+{
+	return chrono::duration_cast<chrono::microseconds>(
+		chrono::steady_clock::now() - _epoch).count();
+}
+
+void FrameClock::Tick()
+{
+	const uint64_t n = _count.load(memory_order_relaxed);
+	_stamps[n % CAPACITY].store(Now(), memory_order_relaxed);
+	_count.store(n + 1, memory_order_release);
+}
+
+FrameTimeStats FrameClock::Summarize(const float window) const
+{
+	FrameTimeStats stats = { 0.f, 0.f, 0.f, 0.f, 0, 0 };
+
+	// snapshot the newest timestamps
+	const uint64_t end = _count.load(memory_order_acquire);
+	const uint64_t begin = end > CAPACITY ? end - CAPACITY : 0;
+
+	vector<int64_t> stamps;
+	stamps.reserve(static_cast<size_t>(end - begin));
+	for (uint64_t i = begin; i < end; ++i) {
+		stamps.push_back(_stamps[i % CAPACITY].load(memory_order_relaxed));
+	}
+
+	// the writer may have lapped the oldest entries meanwhile. Entry *after*
+	// may be being written already, so its slot (that of after - CAPACITY)
+	// is dropped as well.
+	atomic_thread_fence(memory_order_acquire);
+	const uint64_t after = _count.load(memory_order_relaxed);
+	const uint64_t valid = after + 1 > CAPACITY ? after + 1 - CAPACITY : 0;
+	if (valid > begin) {
+		const uint64_t lapped = std::min(valid, end) - begin;
+		stamps.erase(stamps.begin(), stamps.begin() + static_cast<size_t>(lapped));
+	}
+
+	// keep frames started within the window
+	const int64_t since = Now() - static_cast<int64_t>(window * 1e6f);
+	auto first = std::lower_bound(stamps.begin(), stamps.end(), since);
+	if (stamps.end() - first < 2) {
+		return stats;
+	}
+
+	vector<float> times;
+	times.reserve(stamps.end() - first - 1);
+	for (auto it = first + 1; it != stamps.end(); ++it) {
+		times.push_back((*it - *(it - 1)) / 1e3f);
+	}
+	const float span = (stamps.back() - *first) / 1e3f;
+
+	std::sort(times.begin(), times.end());
+	stats.p50 = Percentile(times, 0.50f);
+	stats.p95 = Percentile(times, 0.95f);
+	stats.p99 = Percentile(times, 0.99f);
+	stats.fps = span > 0.f ? times.size() * 1e3f / span : 0.f;
+	stats.frames = static_cast<uint32_t>(times.size());
+
+	const float hitch = HITCH_FACTOR * stats.p50;
+	stats.hitches = static_cast<uint32_t>(times.end() - 
+		std::upper_bound(times.begin(), times.end(), hitch));
+
+	return stats;
+}
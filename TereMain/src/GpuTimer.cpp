@@ -0,0 +1,73 @@
+#include "GpuTimer.h"
+
+GpuTimer::GpuTimer()
+	: _head(0),
+	_count(0),
+	_ms(-1.f),
+	_created(false)
+{
+}
+
+GpuTimer::~GpuTimer()
+{
+#ifdef USE_GPU_TIMER
+	if (_created) {
+		glDeleteQueries(NUM_QUERIES, _queries);
+	}
+#endif
+}
+
+void GpuTimer::Begin()
+{
+#ifdef USE_GPU_TIMER
+	// created lazily, GL may not be loaded when the owner is constructed
+	if (!_created) {
+		glGenQueries(NUM_QUERIES, _queries);
+		_created = true;
+	}
+
+	Collect();
+
+	// all queries in flight, give up the oldest measurement
+	if (_count == NUM_QUERIES) {
+		_head = (_head + 1) % NUM_QUERIES;
+		--_count;
+	}
+
+	glBeginQuery(GL_TIME_ELAPSED, _queries[(_head + _count) % NUM_QUERIES]);
+#endif
+}
+
+void GpuTimer::End()
+{
+#ifdef USE_GPU_TIMER
+	glEndQuery(GL_TIME_ELAPSED);
+	++_count;
+#endif
+}
+
+float GpuTimer::Elapsed()
+{
+	Collect();
+	return _ms;
+}
+
+void GpuTimer::Collect()
+{
+#ifdef USE_GPU_TIMER
+	while (_count > 0) {
+		GLint available = 0;
+		glGetQueryObjectiv(_queries[_head], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) {
+			break;
+		}
+
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(_queries[_head], GL_QUERY_RESULT, &ns);
+		_ms = static_cast<float>(ns / 1e6);
+
+		_head = (_head + 1) % NUM_QUERIES;
+		--_count;
+	}
+#endif
+}
@@ -0,0 +1,115 @@
+#include "Platform.h"
+
+#ifdef PLATFORM_LINUX
+
+#include <stdexcept>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "HeadlessContext.h"
+#include "common/Log.hpp"
+#include "Error.h"
+
+// prefer the surfaceless platform, which needs neither X nor a GPU device
+static EGLDisplay GetDisplay()
+{
+	EGLDisplay display = EGL_NO_DISPLAY;
+	auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+		eglGetProcAddress("eglGetPlatformDisplayEXT"));
+
+	if (getPlatformDisplay) {
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, 
+			EGL_DEFAULT_DISPLAY, nullptr);
+		if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr)) {
+			return display;
+		}
+	}
+
+	display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr)) {
+		return display;
+	}
+
+	return EGL_NO_DISPLAY;
+}
+
+HeadlessContext::HeadlessContext()
+	: HeadlessContext(nullptr)
+{}
+
+HeadlessContext::HeadlessContext(const HeadlessContext *share)
+	: _display(EGL_NO_DISPLAY),
+	_context(EGL_NO_CONTEXT),
+	_shared(share != nullptr)
+{
+	EGLDisplay display = share ? share->_display : GetDisplay();
+	if (display == EGL_NO_DISPLAY) {
+		THROW_ON_ERROR("HeadlessContext: no EGL display");
+	}
+	_display = display;
+
+	const EGLint configAttribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config = nullptr;
+	EGLint nConfigs = 0;
+
+	if (!eglChooseConfig(display, configAttribs, &config, 1, &nConfigs)) {
+		THROW_ON_ERROR("HeadlessContext: eglChooseConfig failed");
+	}
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		THROW_ON_ERROR("HeadlessContext: desktop OpenGL is not supported");
+	}
+
+	const EGLint contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext context = eglCreateContext(display, nConfigs > 0 ? config : nullptr,
+		share ? share->_context : EGL_NO_CONTEXT, contextAttribs);
+	if (context == EGL_NO_CONTEXT) {
+		THROW_ON_ERROR("HeadlessContext: eglCreateContext failed (0x%x)", 
+			eglGetError());
+	}
+	_context = context;
+
+	// a shared context is meant for another thread
+	if (!share && !MakeCurrent()) {
+		THROW_ON_ERROR("HeadlessContext: eglMakeCurrent failed (0x%x)", 
+			eglGetError());
+	}
+
+	LOGI("HeadlessContext: %s\n", eglQueryString(display, EGL_VENDOR));
+}
+
+HeadlessContext::~HeadlessContext()
+{
+	if (_display != EGL_NO_DISPLAY) {
+		eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (_context != EGL_NO_CONTEXT) {
+			eglDestroyContext(_display, _context);
+		}
+		if (!_shared) {
+			eglTerminate(_display);
+		}
+	}
+}
+
+bool HeadlessContext::MakeCurrent()
+{
+	// no surface: rendering goes to framebuffer objects only
+	return eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, 
+		_context) == EGL_TRUE;
+}
+
+bool HeadlessContext::Release()
+{
+	return eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, 
+		EGL_NO_CONTEXT) == EGL_TRUE;
+}
+
+#endif /* PLATFORM_LINUX */
@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <numeric>
+
+#include "KdTree.h"
+
+void KdTree::Build(const vector<glm::vec3> &points)
+{
+	_ids.resize(points.size());
+	std::iota(_ids.begin(), _ids.end(), 0);
+
+	Split(points, 0, points.size(), 0);
+
+	// store points in tree order for cache friendly queries
+	_points.resize(points.size());
+	for (size_t i = 0; i < _ids.size(); ++i) {
+		_points[i] = points[_ids[i]];
+	}
+}
+
+void KdTree::Split(const vector<glm::vec3> &points, const size_t begin, 
+	const size_t end, const int axis)
+{
+	if (end - begin < 2) {
+		return;
+	}
+
+	// median along axis becomes the subtree root
+	const size_t mid = begin + (end - begin) / 2;
+	std::nth_element(_ids.begin() + begin, _ids.begin() + mid,
+		_ids.begin() + end, [&points, axis](const size_t &a, const size_t &b) {
+		return points[a][axis] < points[b][axis];
+	});
+
+	Split(points, begin, mid, (axis + 1) % 3);
+	Split(points, mid + 1, end, (axis + 1) % 3);
+}
+
+vector<std::pair<float, size_t>> KdTree::Nearest(const glm::vec3 &q, 
+	const size_t k, const size_t exclude, const vector<bool> *mask) const
+{
+	vector<std::pair<float, size_t>> best;
+	if (k == 0) {
+		return best;
+	}
+
+	best.reserve(k);
+	Query(0, _ids.size(), 0, q, k, exclude, mask, best);
+	std::sort_heap(best.begin(), best.end());
+	return best;
+}
+
+void KdTree::Query(const size_t begin, const size_t end, const int axis,
+	const glm::vec3 &q, const size_t k, const size_t exclude,
+	const vector<bool> *mask, vector<std::pair<float, size_t>> &best) const
+{
+	if (begin >= end) {
+		return;
+	}
+
+	const size_t mid = begin + (end - begin) / 2;
+	const glm::vec3 d = _points[mid] - q;
+	const float dis = glm::dot(d, d);
+
+	if (_ids[mid] != exclude && (!mask || (*mask)[_ids[mid]])) {
+		if (best.size() < k) {
+			best.push_back({ dis, _ids[mid] });
+			std::push_heap(best.begin(), best.end());
+		}
+		else if (dis < best.front().first) {
+			std::pop_heap(best.begin(), best.end());
+			best.back() = { dis, _ids[mid] };
+			std::push_heap(best.begin(), best.end());
+		}
+	}
+
+	// visit the side containing q first, the other one only if it 
+	// can hold a closer node
+	const float diff = q[axis] - _points[mid][axis];
+	const int next = (axis + 1) % 3;
+	const size_t nearBegin = diff < 0.f ? begin : mid + 1;
+	const size_t nearEnd = diff < 0.f ? mid : end;
+	const size_t farBegin = diff < 0.f ? mid + 1 : begin;
+	const size_t farEnd = diff < 0.f ? end : mid;
+
+	Query(nearBegin, nearEnd, next, q, k, exclude, mask, best);
+	if (best.size() < k || diff * diff < best.front().first) {
+		Query(farBegin, farEnd, next, q, k, exclude, mask, best);
+	}
+}
@@ -22,6 +22,16 @@ bool LFEngine::SetGeometry(const float *v, const size_t szV, const int *f,
 	return _pImpl->SetGeometry(v, szV, f, szF, GPU);
 }
 
+bool LFEngine::SetGeometryLod(const size_t levels, bool fullDepth)
+{
+	return _pImpl->SetGeometryLod(levels, fullDepth);
+}
+
+void LFEngine::SetFaceCulling(bool enable)
+{
+	_pImpl->SetFaceCulling(enable);
+}
+
 bool LFEngine::SetRefImage(const size_t id, const uint8_t *rgb, const size_t w,
 	const size_t h)
 {
@@ -34,6 +44,28 @@ bool LFEngine::SetRefImage(const size_t id, const string &filename,
 	return _pImpl->SetRefImage(id, filename, zoom);
 }
 
+bool LFEngine::AdoptRefImage(const size_t id, uint8_t *rgb, const size_t w,
+	const size_t h, ReleaseImageFunc release, void *user)
+{
+	return _pImpl->AdoptRefImage(id, rgb, w, h, release, user);
+}
+
+void LFEngine::SetReleaseAfterUpload(bool release)
+{
+	_pImpl->SetReleaseAfterUpload(release);
+}
+
+bool LFEngine::SetRefImages(const vector<size_t> &ids, 
+	const vector<string> &filenames, const float zoom, vector<size_t> *failed)
+{
+	return _pImpl->SetRefImages(ids, filenames, zoom, failed);
+}
+
+void LFEngine::SetDecodeThreads(const size_t n)
+{
+	_pImpl->SetDecodeThreads(n);
+}
+
 void LFEngine::RegisterDecFunc(const DecHeaderFunc hf, const DecImageFunc f)
 {
 	return _pImpl->RegisterDecFunc(hf, f);
@@ -60,14 +92,46 @@ bool LFEngine::HaveUpdatedScene()
 	return _pImpl->HaveUpdatedScene();
 }
 
-void LFEngine::Draw()
+bool LFEngine::SetLoaderContext(LoaderContextFunc bind, void *user)
 {
-	_pImpl->Draw();
+	return _pImpl->SetLoaderContext(bind, user);
 }
 
-void LFEngine::StartFPSThread(void)
+bool LFEngine::IsLoading(void) const
 {
-	_pImpl->StartFPSThread();
+	return _pImpl->IsLoading();
+}
+
+bool LFEngine::Draw()
+{
+	return _pImpl->Draw();
+}
+
+void LFEngine::SetRedrawOnChange(bool enable)
+{
+	_pImpl->SetRedrawOnChange(enable);
+}
+
+void LFEngine::SetSelectionThreshold(float degrees)
+{
+	_pImpl->SetSelectionThreshold(degrees);
+}
+
+void LFEngine::SetPipelining(bool enable)
+{
+	_pImpl->SetPipelining(enable);
+}
+
+void LFEngine::SetDynamicResolution(float targetMs, float minScale)
+{
+	_pImpl->SetDynamicResolution(targetMs, minScale);
+}
+
+bool LFEngine::RenderPoses(const vector<array<float, 9>> &Ks, 
+	const vector<array<float, 16>> &Ms, bool w2c, bool yIsUp, 
+	vector<vector<uint8_t>> &rgbas)
+{
+	return _pImpl->RenderPoses(Ks, Ms, w2c, yIsUp, rgbas);
 }
 
 void LFEngine::Resize(uint32_t width, uint32_t height)
@@ -100,6 +164,31 @@ float LFEngine::GetFPS() const
 	return _pImpl->GetFPS();
 }
 
+FrameTimeStats LFEngine::GetFrameTimes(const float window) const
+{
+	return _pImpl->GetFrameTimes(window);
+}
+
+FrameStats LFEngine::GetFrameStats()
+{
+	return _pImpl->GetFrameStats();
+}
+
+void LFEngine::SetScreenShotSink(ScreenShotSinkFunc sink, void *user)
+{
+	_pImpl->SetScreenShotSink(sink, user);
+}
+
+bool LFEngine::QueueScreenShot(int x, int y, int width, int height)
+{
+	return _pImpl->QueueScreenShot(x, y, width, height);
+}
+
+size_t LFEngine::FlushScreenShots(bool wait)
+{
+	return _pImpl->FlushScreenShots(wait);
+}
+
 bool LFEngine::SetBackground(float r, float g, float b)
 {
 	return _pImpl->SetBackground(r, g, b);
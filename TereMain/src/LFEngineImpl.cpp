@@ -1,8 +1,12 @@
 #include <chrono>
+#include <cmath>
 #include <cstdlib>
 #include <algorithm>
 #include <numeric>
 #include <thread>
+#include <cstring>
+#include <atomic>
+#include <mutex>
 
 #include "Config.h"
 #include "common/Log.hpp"
@@ -15,11 +19,15 @@
 #include "LFEngineImpl.h"
 #include "Error.h"
 #include "Renderer.h"
-#include "TextureFuser.h"
+#include "GLHeader.h"
 #include "Poster.h"
+#include "Readback.h"
+#include "GpuTimer.h"
+#include "Worker.h"
 #include "TereScene.h"
 #include "WeightedCamera.h"
 #include "image/Image.hpp"
+#include "Memory.h"
 
 using namespace std;
 
@@ -51,40 +59,30 @@ static bool DecodeImage(const string &file, const DecHeaderFunc &fdh,
 	return true;
 }
 
-static float AverageNorm(const vector<Extrinsic> &cameras)
+static float MsSince(const chrono::high_resolution_clock::time_point &start)
 {
-	const size_t N = cameras.size();
-	vector<float> nnDist(N);
-
-	if (N == 0) { return 0.f; }
+	return chrono::duration<float, std::milli>(
+		chrono::high_resolution_clock::now() - start).count();
+}
 
-	// calculate nearest neighbor for every cameras
-	for (size_t i = 0; i < N; ++i) {
-		const glm::vec3 &myPos = cameras[i].Pos();
-		float minDist = std::numeric_limits<float>::max();
-
-		for (size_t j = 0; j < N; ++j) {
-			if (j == i) continue;
-			const glm::vec3 &pos = cameras[j].Pos();
-			const glm::vec3 &diff = myPos - pos;
-			float dist = glm::dot(diff, diff);
-			if (dist < minDist) { minDist = dist; }
-		}
+static float AverageNorm(const CameraRig &rig)
+{
+	const size_t N = rig.nnSqDists.size();
 
-		nnDist[i] = minDist;
-	}
+	if (N == 0) { return 0.f; }
 
-	// compute average distance
-	float average = std::accumulate(nnDist.cbegin(), nnDist.cend(), 0.f) / N;
+	// average (squared) distance to the nearest neighbor of every camera
+	float average = std::accumulate(rig.nnSqDists.cbegin(), 
+		rig.nnSqDists.cend(), 0.f) / N;
 	return average;
 }
 
-static float CalculateSlotsMultiplier(const vector<Extrinsic> &extrinsics)
+static float CalculateSlotsMultiplier(const CameraRig &rig)
 {
 	// Maximum slots between i-th ref camera and its NN j-th ref camera.
 	const float HARD_CODED_INTERVAL = 15.f;
 
-	return HARD_CODED_INTERVAL / AverageNorm(extrinsics);
+	return HARD_CODED_INTERVAL / AverageNorm(rig);
 }
 
 LFEngineImpl::LFEngineImpl(const size_t nCams, const RENDER_MODE mode)
@@ -93,17 +91,33 @@ LFEngineImpl::LFEngineImpl(const size_t nCams, const RENDER_MODE mode)
 	_scene(nullptr),
 	fdh(nullptr),
 	fdi(nullptr),
+	_decThreads(0),
 	_renderer(nullptr),
-	_textureFuser(nullptr),
 	_poster(nullptr),
+	_readback(nullptr),
+	_posterTimer(nullptr),
+	_shotSink(nullptr),
+	_shotUser(nullptr),
 	_renderCam(),
 	_UI(nullptr),
 	_fixRef(0),
-	_fps(0),
-	_frames(0),
+	_dragging(false),
 	_schStrg(nullptr),
 	_wghStrg(nullptr),
-	_locked(false)
+	_reselectCos(std::cos(glm::radians(SELECTION_THRESHOLD))),
+	_locked(false),
+	_redrawOnChange(true),
+	_frameValid(false),
+	_frameHash(0),
+	_stateVersion(0),
+	_worker(nullptr),
+	_pipelining(true),
+	_front(0),
+	_loaderBind(nullptr),
+	_loaderUser(nullptr),
+	_loading(false),
+	_stats({ -1.f, -1.f, -1.f, 0.f, 0.f, 0.f, 0.f, 1.f, false, false }),
+	_slotTime(0.f)
 {
 	if (nCams == 0) {
 		THROW_ON_ERROR("Invalid nCams");
@@ -115,6 +129,9 @@ LFEngineImpl::LFEngineImpl(const size_t nCams, const RENDER_MODE mode)
 	_scene.reset(new TereScene(nCams));
 	_scene->rmode = mode;
 
+	_frameStates[0].valid = _frameStates[1].valid = false;
+	_frameStates[0].key = _frameStates[1].key = 0;
+
 	if (nCams > MAX_NUM_INTERP && mode == ALL) {
 		LOGW("[WARNING] LFEngine: No. cameras is too large. Try not use ALL mode\n");
 	}
@@ -122,9 +139,12 @@ LFEngineImpl::LFEngineImpl(const size_t nCams, const RENDER_MODE mode)
 
 LFEngineImpl::~LFEngineImpl(void)
 {
+	_worker = nullptr;
+	_decoders.clear();
 	_scene = nullptr;
 	_renderer = nullptr;
-	_textureFuser = nullptr;
+	_readback = nullptr;
+	_posterTimer = nullptr;
 	_poster = nullptr;
 	_UI = nullptr;
 }
@@ -135,6 +155,7 @@ bool LFEngineImpl::SetGeometry(const float * v, const size_t szV, bool GPU)
 		RETURN_ON_ERROR("v is NULL");
 	}
 
+	PollLoader(true);
 	return _scene->UpdateGeometry(v, szV, nullptr, 0, GPU);
 }
 
@@ -148,9 +169,31 @@ bool LFEngineImpl::SetGeometry(const float *v, const size_t szV, const int *f,
 		RETURN_ON_ERROR("f is NULL");
 	}
 
+	PollLoader(true);
 	return _scene->UpdateGeometry(v, szV, f, szF, GPU);
 }
 
+bool LFEngineImpl::SetGeometryLod(const size_t levels, bool fullDepth)
+{
+	PollLoader(true);
+	_scene->lodLevels = std::max<size_t>(levels, 1);
+	_scene->lodFullDepth = fullDepth;
+
+	// geometry set before is simplified again
+	if (!_scene->dElement) {
+		return true;
+	}
+	_scene->dirtyGeometry = true;
+	return _scene->BuildLods() && _scene->BuildMeshlets();
+}
+
+void LFEngineImpl::SetFaceCulling(bool enable)
+{
+	Sync();
+	_scene->cullFaces = enable;
+	++_stateVersion;
+}
+
 #define CHECK_ID(id, max) do {\
 	if (id < 0 || id >= max) RETURN_ON_ERROR("Invalid camera index");\
 } while (0)
@@ -160,6 +203,7 @@ bool LFEngineImpl::SetRefImage(const size_t id, const uint8_t *rgb, const size_t
 {
 	CHECK_ID(id, _scene->nCams);
 
+	PollLoader(true);
 	return _scene->UpdateImage(id, rgb, w, h);
 }
 
@@ -171,6 +215,32 @@ bool LFEngineImpl::SetRefImage(const size_t id, const string & filename,
 	if (filename.empty()) {
 		RETURN_ON_ERROR("filename is empty");
 	}
+
+	// decode in place through the batch path
+	return SetRefImages(vector<size_t>{ id }, vector<string>{ filename }, zoom);
+}
+
+bool LFEngineImpl::AdoptRefImage(const size_t id, uint8_t *rgb, const size_t w,
+	const size_t h, ReleaseImageFunc release, void *user)
+{
+	CHECK_ID(id, _scene->nCams);
+
+	PollLoader(true);
+	return _scene->AdoptImage(id, rgb, w, h, release, user);
+}
+
+void LFEngineImpl::SetReleaseAfterUpload(bool release)
+{
+	PollLoader(true);
+	_scene->releaseAfterUpload = release;
+}
+
+bool LFEngineImpl::SetRefImages(const vector<size_t> &ids, 
+	const vector<string> &filenames, const float zoom, vector<size_t> *failed)
+{
+	if (ids.size() != filenames.size()) {
+		RETURN_ON_ERROR("ids and filenames differ in length");
+	}
 	if (zoom < 1e-3) {
 		RETURN_ON_ERROR("Too small zooming factor");
 	}
@@ -178,25 +248,138 @@ bool LFEngineImpl::SetRefImage(const size_t id, const string & filename,
 		RETURN_ON_ERROR("Image decoding functions are not registered properly");
 	}
 
-	int width = 0, height = 0;
-	shared_ptr<uint8_t> image = nullptr;
+	const size_t N = ids.size();
+	vector<char> ok(N, 0);
+
+	PollLoader(true);
 
-	if (!DecodeImage(filename, fdh, fdi, image, width, height, zoom)) {
-		RETURN_ON_ERROR("Decode image failed");
+	// a camera listed more than once takes its last file, so that no two 
+	// decoders write the same buffer
+	vector<size_t> last(_scene->nCams, N);
+	for (size_t i = 0; i < N; ++i) {
+		if (ids[i] >= _scene->nCams) {
+			LOGE("[ERROR] Invalid camera index: %d\n", (int)ids[i]);
+			continue;
+		}
+		last[ids[i]] = i;
+	}
+	vector<size_t> jobs;
+	for (size_t i = 0; i < N; ++i) {
+		if (ids[i] >= _scene->nCams || last[ids[i]] == i) {
+			jobs.push_back(i);
+		}
 	}
 
-	if (!_scene->UpdateImage(id, image.get(), width, height)) {
-		RETURN_ON_ERROR("Scene update image failed");
+	// decode headers in parallel, then check sizes serially (the scene takes
+	// its size from the first image)
+	vector<array<int, 2>> sizes(N);
+	RunDecoders(jobs.size(), [&](size_t j) {
+		const size_t i = jobs[j];
+		if (ids[i] >= _scene->nCams) return;
+		if (!fdh(filenames[i].c_str(), &sizes[i][0], &sizes[i][1])) {
+			LOGE("[ERROR] DecHeaderFunc failed on %s\n", filenames[i].c_str());
+			return;
+		}
+		ok[i] = 1;
+	});
+	for (const size_t i : jobs) {
+		if (!ok[i]) continue;
+		if (!_scene->CheckImage(ids[i], int(sizes[i][0] * zoom), 
+			int(sizes[i][1] * zoom))) {
+			LOGE("[ERROR] Cannot fit image %d for %s\n", (int)ids[i],
+				filenames[i].c_str());
+			ok[i] = 0;
+		}
+	}
+
+	// decode images in parallel into staging buffers, which replace the
+	// scene's only once decoded, so failures leave the old images alone
+	const int width = _scene->width;
+	const int height = _scene->height;
+	const size_t size = width * height * 3;
+	mutex install;
+
+	const size_t nThreads = RunDecoders(jobs.size(), [&](size_t j) {
+		const size_t i = jobs[j];
+		if (!ok[i]) return;
+
+		unique_ptr<uint8_t[]> buf(new uint8_t[size]);
+		ok[i] = fdi(filenames[i].c_str(), width, height, buf.get(), size);
+		if (!ok[i]) return;
+
+		lock_guard<mutex> lock(install);
+#ifdef USE_CUDA
+		ok[i] = _scene->UpdateImage(ids[i], buf.get(), width, height);
+#else
+		ok[i] = _scene->TakeImage(ids[i], buf.get(), width, height);
+		if (ok[i]) buf.release();
+#endif
+	});
+
+	// aggregate results, dropped duplicates are not counted
+	size_t nFailed = 0;
+	for (const size_t i : jobs) {
+		if (ok[i]) {
+			_scene->dirtyImages[ids[i]] = true;
+			continue;
+		}
+		++nFailed;
+		if (failed) { failed->push_back(ids[i]); }
+	}
+
+	LOGI("ENGINE: decoded %d images with %d threads\n", 
+		int(jobs.size() - nFailed), int(nThreads));
+
+	if (nFailed > 0) {
+		RETURN_ON_ERROR("%d of %d images failed to load", (int)nFailed, 
+			(int)jobs.size());
 	}
 
 	return true;
 }
 
+size_t LFEngineImpl::RunDecoders(const size_t n, 
+	const function<void(size_t)> &job)
+{
+	size_t nThreads = _decThreads ? _decThreads : thread::hardware_concurrency();
+	nThreads = std::max<size_t>(1, std::min(nThreads, n));
+
+	// decoding threads persist between batches
+	while (_decoders.size() + 1 < nThreads) {
+		_decoders.emplace_back(new Worker());
+	}
+
+	atomic<size_t> next(0);
+	auto run = [&]() {
+		for (size_t i = next++; i < n; i = next++) {
+			job(i);
+		}
+	};
+	for (size_t t = 0; t + 1 < nThreads; ++t) {
+		_decoders[t]->Submit(run);
+	}
+	run();
+	for (size_t t = 0; t + 1 < nThreads; ++t) {
+		_decoders[t]->Wait();
+	}
+	return nThreads;
+}
+
+void LFEngineImpl::SetDecodeThreads(const size_t n)
+{
+	_decThreads = n;
+	if (n > 0 && _decoders.size() >= n) {
+		_decoders.resize(n - 1);
+	}
+}
+
 bool LFEngineImpl::SetCamera(const size_t id, const array<float, 9> &K, 
 	const array<float, 16> &M, bool w2c, bool yIsUp)
 {
 	CHECK_ID(id, _scene->nCams);
 
+	Sync();
+	PollLoader(true);
 	return _scene->UpdateCamera(id, K, M, w2c, yIsUp);
 }
 
@@ -213,24 +396,36 @@ void LFEngineImpl::RegisterDecFunc(const DecHeaderFunc _fdh, const DecImageFunc
 
 bool LFEngineImpl::HaveSetScene()
 {
+	// the worker is restarted once strategies are replaced
+	_worker = nullptr;
+	PollLoader(true);
+
 	if (!_scene->Configure()) return false;
 
+	// a new renderer needs every image on the host
+	for (auto rgb : _scene->rgbs) {
+		if (!rgb) {
+			RETURN_ON_ERROR("Reference images were released after upload");
+		}
+	}
+
 	try {
 		// Initialize scene renderer
 		LOGI("ENGINE: preparing scene renderer\n");
 		_renderer.reset(new Renderer(_scene));
-		_renderer->UpdatedGeometry();
-		_renderer->UpdatedLF();
+		if (_loaderBind && !_renderer->StartLoader(_loaderBind, _loaderUser)) {
+			RETURN_ON_ERROR("cannot start loader");
+		}
 
 		// initialize texture fuser
-		LOGI("ENGINE: preparing TextureFuser\n");
-		_textureFuser.reset(new TextureFuser(_scene->width, _scene->height,
-			0.f, 0.f, 0.f));
-
-		// initialize poster for screen rendering
+		// initialize poster for background blending and screen rendering
 		LOGI("ENGINE: preparing Poster\n");
 		_poster.reset(new Poster());
 
+		// asynchronous screenshots
+		_readback.reset(new Readback());
+		_posterTimer.reset(new GpuTimer());
+
 		LOGI("ENGINE: setting others\n");
 		
 		// initialize viewport sizes
@@ -243,12 +438,12 @@ bool LFEngineImpl::HaveSetScene()
 		{
 		case RENDER_MODE::LINEAR:
 			_renderCam = Camera({ _scene->intrins[0], _scene->extrins[0] });
-			_schStrg.reset(new DefaultSearchStrategy(_scene->center));
+			_schStrg.reset(new KdSearchStrategy);
 			_UI.reset(new LinearUI(_scene->extrins, _scene->rows, 0, _scene->width, _scene->height));
 			break;
 		case RENDER_MODE::ALL:
 			_renderCam = Camera({ _scene->intrins[0], Extrinsic(
-				&(_scene->extrins[0].Pos())[0], 
+				&(_scene->rig.positions[0])[0], 
 				&(_scene->center)[0],
 				&(_scene->extrins[0].Up())[0]) });
 			_schStrg.reset(new AllSearchStrategy);
@@ -256,10 +451,10 @@ bool LFEngineImpl::HaveSetScene()
 			break;
 		case RENDER_MODE::SPHERE: 
 			_renderCam = Camera({ _scene->intrins[0], Extrinsic(
-				&(_scene->extrins[0].Pos())[0],
+				&(_scene->rig.positions[0])[0],
 				&(_scene->center)[0],
 				&(_scene->extrins[0].Up())[0]) });
-			_schStrg.reset(new DefaultSearchStrategy(_scene->center));
+			_schStrg.reset(new KdSearchStrategy);
 			_UI.reset(new ArcballUI(_scene->width, _scene->height, _scene->center));
 			break;
 		default:
@@ -268,118 +463,544 @@ bool LFEngineImpl::HaveSetScene()
 		}
 
 		// weighing strategy is default
-		_wghStrg.reset(new DefaultWeighStrategy(_scene->center));
+		_wghStrg.reset(new DefaultWeighStrategy);
 
 		// (in)decrease focal length to simulate zooming effects
 		_stdFx = _renderCam.intrin.fx;
 		_stdFy = _renderCam.intrin.fy;
 
 		// compute intervals per distance
-		_SLOT_MULTIPLIER = CalculateSlotsMultiplier(_scene->extrins);
+		_SLOT_MULTIPLIER = CalculateSlotsMultiplier(_scene->rig);
+
+		if (_pipelining) {
+			_worker.reset(new Worker());
+		}
 	}
 	catch (std::exception &e) {
 		THROW_ON_ERROR(e.what());
 	}
 
+	++_stateVersion;
 	return true;
 }
 
 bool LFEngineImpl::HaveUpdatedScene()
 {
+	Sync();
+	PollLoader(true);
+
 	if (!_scene->Configure()) {
 		return false;
 	}
 
+	// only changed data is uploaded and re-baked
 	if (_renderer) {
 		_renderer->UpdatedGeometry();
-		_renderer->UpdatedLF();
+		_renderer->UpdatedCameras();
+
+		// images go to the loader if nothing else needs re-baking, their 
+		// cameras sit out selection until they are ready
+		vector<size_t> loading;
+		if (_renderer->LoadLF(loading)) {
+			for (const size_t id : loading) {
+				_scene->rig.eligible[id] = false;
+			}
+			_loading = !loading.empty();
+		}
+		else {
+			_renderer->UpdatedLF();
+		}
 	}
+
+	++_stateVersion;
 	return true;
 }
 
-void LFEngineImpl::Draw(void)
+bool LFEngineImpl::SetLoaderContext(LoaderContextFunc bind, void *user)
 {
+	if (!bind) {
+		RETURN_ON_ERROR("bind is NULL");
+	}
+
+	_loaderBind = bind;
+	_loaderUser = user;
+
+	// otherwise started along with the renderer
+	if (_renderer) {
+		PollLoader(true);
+		return _renderer->StartLoader(bind, user);
+	}
+
+	return true;
+}
+
+void LFEngineImpl::PollLoader(bool wait)
+{
+	vector<size_t> loaded;
+	if (!_loading || !_renderer->PollLoader(loaded, wait)) {
+		return;
+	}
+
+	// the whole batch joins at once, between two frames. The new version
+	// forces a scene pass, whose texture binds make the loader's writes
+	// visible in this context.
+	Sync();
+	for (const size_t id : loaded) {
+		_scene->rig.eligible[id] = true;
+	}
+	_loading = false;
+	++_stateVersion;
+}
+
+bool LFEngineImpl::Draw(void)
+{
+	const auto start = chrono::high_resolution_clock::now();
+	_clock.Tick();
+
 	if (_locked) {
 		_renderCam.extrin = _slotQueue.front();
 		_slotQueue.pop_front();
 		_locked = !_slotQueue.empty();
 	}
+	_stats.cpuSlot = _slotTime + MsSince(start);
+	_slotTime = 0.f;
+
+	// the scene resolution is part of the frame, pick it before hashing
+	ScaleResolution();
+
+	// hand out screenshots that have landed meanwhile
+	if (_readback) {
+		_readback->Poll(_shotSink, _shotUser, false);
+	}
+
+	// cameras loaded in the background become selectable. A fixed camera 
+	// bypasses selection, so one still being loaded is waited for.
+	PollLoader(_loading && _mode == FIX && !_scene->rig.eligible[_fixRef]);
+
+	// nothing changed since the last frame, present it again
+	const uint64_t key = PrepareHash(_renderCam);
+	const uint64_t hash = FrameHash(_renderCam);
+	if (_redrawOnChange && _frameValid && hash == _frameHash) {
+		_posterTimer->Begin();
+		_poster->Render(_screenViewport);
+		_posterTimer->End();
+
+		_stats.cpuSearch = _stats.cpuWeigh = 0.f;
+		_stats.rendered = _stats.prepared = false;
+		_stats.cpuDraw = MsSince(start);
+		return false;
+	}
+
+	// take the frame prepared by the worker if it guessed right
+	Sync();
+	FrameState &next = _frameStates[1 - _front];
+	_stats.prepared = next.valid && next.key == key;
+	if (_stats.prepared) {
+		_front = 1 - _front;
+	}
+	else {
+		PrepareFrame(_renderCam, _mode, _fixRef, _stateVersion, _selection,
+			_frameStates[_front]);
+		_frameStates[_front].key = key;
+	}
+	_frameStates[1 - _front].valid = false;
+
+	// guesses that were not drawn leave the selection alone
+	const FrameState &state = _frameStates[_front];
+	_selection = state.selection;
+	_stats.cpuSearch = state.searchTime;
+	_stats.cpuWeigh = state.weighTime;
+
+	// the worker prepares the next frame while this one is submitted
+	PrepareNext();
+	_Draw(state);
+	_frameHash = hash;
+	_frameValid = true;
+	_scaler.Measured(_renderer->ScenePassTime(), _posterTimer->Elapsed());
+
+	_stats.rendered = true;
+	_stats.cpuDraw = MsSince(start);
+	return true;
+}
+
+FrameStats LFEngineImpl::GetFrameStats()
+{
+	if (_renderer && _posterTimer) {
+		_stats.gpuDepth = _renderer->DepthPassTime();
+		_stats.gpuScene = _renderer->ScenePassTime();
+		_stats.gpuPoster = _posterTimer->Elapsed();
+	}
+
+	return _stats;
+}
+
+void LFEngineImpl::SetRedrawOnChange(bool enable)
+{
+	_redrawOnChange = enable;
+	_frameValid = false;
+}
+
+void LFEngineImpl::SetDynamicResolution(float targetMs, float minScale)
+{
+	_scaler.SetBudget(targetMs, minScale);
+}
+
+void LFEngineImpl::ScaleResolution()
+{
+	// slots continue the drag until the view settles
+	const float scale = _scaler.Next(_dragging || _locked);
+	const int width = std::max(1, static_cast<int>(_scene->width * scale + 0.5f));
+	const int height = std::max(1, static_cast<int>(_scene->height * scale + 0.5f));
+
+	_offlineViewport = vector<int>{ 0, 0, width, height };
+	_poster->SetRegion(static_cast<float>(width) / _scene->width,
+		static_cast<float>(height) / _scene->height);
+	_stats.renderScale = scale;
+}
+
+void LFEngineImpl::SetSelectionThreshold(float degrees)
+{
+	Sync();
 
-	_Draw();
+	// no cosine reaches 2, so a zero threshold never reuses
+	_reselectCos = degrees > 0.f ? std::cos(glm::radians(degrees)) : 2.f;
 }
 
-void LFEngineImpl::_Draw(void)
+const vector<size_t> &LFEngineImpl::SelectInterp(const Extrinsic &extrin, 
+	const uint64_t version, const size_t maxn, Selection &sel) const
 {
-	switch (_mode) {
+	const CameraRig &rig = _scene->rig;
+	const glm::vec3 dir = glm::normalize(extrin.Pos() - rig.center);
+
+	// barely moved, keep the current selection
+	vector<size_t> &indices = sel.indices;
+	if (!indices.empty() && sel.version == version &&
+		glm::dot(dir, sel.dir) >= _reselectCos) {
+		return indices;
+	}
+
+	const vector<size_t> found = _schStrg->Search(rig, extrin, maxn);
+	sel.dir = dir;
+	sel.version = version;
+
+	// cameras being reloaded cannot be kept either
+	const bool allEligible = std::all_of(indices.begin(), 
+		indices.end(), [&rig](const size_t id) { 
+		return rig.eligible[id]; 
+	});
+	if (indices.size() != found.size() || !allEligible) {
+		indices = found;
+		return indices;
+	}
+
+	// selected cameras that are no longer found, worst first, and found 
+	// cameras not selected yet, best first
+	auto distance = [&rig, &dir](const size_t id) {
+		return 1.f - glm::dot(dir, rig.directions[id]);
+	};
+	auto selected = [&indices](const size_t id) {
+		return std::find(indices.begin(), indices.end(), id) !=
+			indices.end();
+	};
+
+	vector<size_t> losers;
+	for (size_t slot = 0; slot < indices.size(); ++slot) {
+		if (std::find(found.begin(), found.end(), indices[slot]) ==
+			found.end()) {
+			losers.push_back(slot);
+		}
+	}
+	std::sort(losers.begin(), losers.end(), [&](const size_t a, const size_t b) {
+		return distance(indices[a]) > distance(indices[b]);
+	});
+
+	// a challenger takes over a slot only if clearly closer, so cameras at
+	// the border of the selection do not flip every frame
+	size_t l = 0;
+	for (const size_t id : found) {
+		if (selected(id)) {
+			continue;
+		}
+		if (l == losers.size() || distance(id) >= 
+			distance(indices[losers[l]]) * (1.f - SELECTION_HYSTERESIS)) {
+			break;
+		}
+		indices[losers[l++]] = id;
+	}
+
+	return indices;
+}
+
+// FNV-1a
+static uint64_t HashBytes(uint64_t hash, const void *data, const size_t sz)
+{
+	const uint8_t *bytes = static_cast<const uint8_t*>(data);
+
+	for (size_t i = 0; i < sz; ++i) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+uint64_t LFEngineImpl::PrepareHash(const Camera &cam) const
+{
+	uint64_t hash = 14695981039346656037ull;
+	const glm::mat4 &view = cam.extrin.viewMat;
+	const float intrin[4] = { cam.intrin.cx, cam.intrin.cy,
+		cam.intrin.fx, cam.intrin.fy };
+	const int mode = static_cast<int>(_mode);
+
+	hash = HashBytes(hash, &view[0][0], sizeof(glm::mat4));
+	hash = HashBytes(hash, intrin, sizeof(intrin));
+	hash = HashBytes(hash, &mode, sizeof(mode));
+	hash = HashBytes(hash, &_fixRef, sizeof(_fixRef));
+	hash = HashBytes(hash, &_stateVersion, sizeof(_stateVersion));
+
+	return hash;
+}
+
+uint64_t LFEngineImpl::FrameHash(const Camera &cam) const
+{
+	// the viewports size the GL passes only, prepared state stays valid
+	uint64_t hash = PrepareHash(cam);
+
+	hash = HashBytes(hash, _offlineViewport.data(), 
+		_offlineViewport.size() * sizeof(int));
+	hash = HashBytes(hash, _screenViewport.data(), 
+		_screenViewport.size() * sizeof(int));
+
+	return hash;
+}
+
+void LFEngineImpl::PrepareFrame(const Camera &cam, const InterpMode mode,
+	const size_t fixRef, const uint64_t version, const Selection &prev,
+	FrameState &state)
+{
+	state.selection = prev;
+
+	switch (mode) {
 	case INTERP: {
-		_renderer->SetViewer(glm::mat4(1.f), _renderCam.extrin.viewMat,
-			_renderCam.intrin.ProjMat(_scene->glnear, _scene->glfar,
-				_scene->width, _scene->height));
+		state.view = cam.extrin.viewMat;
+		state.proj = cam.intrin.ProjMat(_scene->glnear, _scene->glfar,
+			_scene->width, _scene->height);
 
 		// search interpolation cameas and calculate weights
 		size_t nInterp = MAX_NUM_INTERP;
 		vector<size_t> indices;
 		vector<float> weights;
 
+		auto start = chrono::high_resolution_clock::now();
 		if (_schStrg) {
-			indices = _schStrg->Search(_scene->extrins, _renderCam.extrin, nInterp);
+			indices = SelectInterp(cam.extrin, version, nInterp, 
+				state.selection);
 		}
 		else {
 			indices = _UI->HintInterp();
 		}
+		state.searchTime = MsSince(start);
 		
-		weights = _wghStrg->Weigh(_scene->extrins, _renderCam.extrin, indices);
+		start = chrono::high_resolution_clock::now();
+		weights = _wghStrg->Weigh(_scene->rig, cam.extrin, indices);
 		nInterp = std::min(indices.size(), weights.size());
+		state.weighTime = MsSince(start);
 
-		_renderer->ClearInterpCameras();
+		state.cams.clear();
 
-		for (size_t i = 0; i < indices.size(); ++i) {
-			_renderer->AddInterpCameras(WeightedCamera(indices[i], weights[i]));
+		for (size_t i = 0; i < nInterp; ++i) {
+			state.cams.push_back(WeightedCamera(indices[i], weights[i]));
 		}
 
 		break;
 	}
 	case FIX: {
-		_renderer->SetViewer(glm::mat4(1.f), _scene->extrins[_fixRef].viewMat,
-			_scene->intrins[_fixRef].ProjMat(_scene->glnear, _scene->glfar,
-				_scene->width, _scene->height));
+		state.view = _scene->extrins[fixRef].viewMat;
+		state.proj = _scene->intrins[fixRef].ProjMat(_scene->glnear, 
+			_scene->glfar, _scene->width, _scene->height);
 
 		// select a fixed camera for interpolation
-		_renderer->ClearInterpCameras();
-		_renderer->AddInterpCameras(WeightedCamera(
-			static_cast<int>(_fixRef), 1.0));
+		state.searchTime = state.weighTime = 0.f;
+		state.cams.assign(1, WeightedCamera(static_cast<int>(fixRef), 1.0));
 		break;
 	}
 	default:break;
 	}
 
+	state.valid = true;
+}
+
+void LFEngineImpl::PrepareNext()
+{
+	// the UI hints cameras from its own state, which the client changes.
+	// Input must not wait for a guess still being prepared.
+	if (!_worker || !_schStrg || _worker->Busy()) {
+		return;
+	}
+
+	// the next slot is known, otherwise input moved the camera already or
+	// it stays
+	Camera cam = _renderCam;
+	if (_locked) {
+		cam.extrin = _slotQueue.front();
+	}
+
+	FrameState *state = &_frameStates[1 - _front];
+	const uint64_t key = PrepareHash(cam);
+	if (key == _frameStates[_front].key || (state->valid && state->key == key)) {
+		return;
+	}
+
+	const InterpMode mode = _mode;
+	const size_t fixRef = _fixRef;
+	const uint64_t version = _stateVersion;
+	const Selection prev = _selection;
+
+	state->valid = false;
+	_worker->Submit([this, cam, mode, fixRef, version, prev, key, state]() {
+		PrepareFrame(cam, mode, fixRef, version, prev, *state);
+		state->key = key;
+	});
+}
+
+void LFEngineImpl::Sync()
+{
+	if (_worker) {
+		_worker->Wait();
+	}
+}
+
+void LFEngineImpl::SetPipelining(bool enable)
+{
+	Sync();
+	_pipelining = enable;
+
+	if (!enable) {
+		_worker = nullptr;
+	}
+	else if (_renderer && !_worker) {
+		_worker.reset(new Worker());
+	}
+}
+
+void LFEngineImpl::_Draw(const FrameState &state)
+{
+	_renderer->SetViewer(glm::mat4(1.f), state.view, state.proj);
+
+	_renderer->ClearInterpCameras();
+	for (const auto &cam : state.cams) {
+		_renderer->AddInterpCameras(cam);
+	}
+
 	// 1st pass: scene rendering
 	unsigned int renderTex = _renderer->Render(_offlineViewport);
-	
-	// 2nd pass: background fusion
-	_textureFuser->SetForeground(renderTex);
-	unsigned int fusedTex = _textureFuser->Render(_offlineViewport);
 
-	// 3rd pass: render to screen 
-	_poster->SetTexture(fusedTex);
+	// 2nd pass: blend background and render to screen
+	_poster->SetTexture(renderTex);
+	_posterTimer->Begin();
 	_poster->Render(_screenViewport);
-	++_frames;
+	_posterTimer->End();
 }
 
-void LFEngineImpl::StartFPSThread(void)
+bool LFEngineImpl::RenderPoses(const vector<array<float, 9>> &Ks, 
+	const vector<array<float, 16>> &Ms, bool w2c, bool yIsUp, 
+	vector<vector<uint8_t>> &rgbas)
 {
-	std::thread t(&LFEngineImpl::VRFPS, this);
-	t.detach();
+	if (!_renderer || !_poster) {
+		RETURN_ON_ERROR("Scene is not set");
+	}
+	if (Ks.size() != Ms.size()) {
+		RETURN_ON_ERROR("Ks and Ms differ in length");
+	}
+
+	const int width = _scene->width;
+	const int height = _scene->height;
+	const size_t rowSize = width * 4;
+
+	// offscreen target replacing the screen
+	GLuint fbo = 0, rbo = 0;
+	glGenFramebuffers(1, &fbo);
+	glGenRenderbuffers(1, &rbo);
+	glBindRenderbuffer(GL_RENDERBUFFER, rbo);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 
+		GL_RENDERBUFFER, rbo);
+	const bool complete = 
+		glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (!complete) {
+		glDeleteFramebuffers(1, &fbo);
+		glDeleteRenderbuffers(1, &rbo);
+		RETURN_ON_ERROR("Incomplete pose framebuffer");
+	}
+
+	// keep the interactive state
+	Sync();
+	const Camera renderCam = _renderCam;
+	const InterpMode mode = _mode;
+	const vector<int> screenViewport = _screenViewport;
+	const vector<int> offlineViewport = _offlineViewport;
+	const unsigned int screenFBO = _poster->ScreenFBO();
+
+	// poses are always rendered at full resolution
+	_mode = INTERP;
+	_screenViewport = vector<int>{ 0, 0, width, height };
+	_offlineViewport = vector<int>{ 0, 0, width, height };
+	_poster->SetRegion(1.f, 1.f);
+	_poster->SetScreenFBO(fbo);
+
+	rgbas.assign(Ks.size(), vector<uint8_t>(rowSize * height));
+	vector<uint8_t> row(rowSize);
+
+	for (size_t i = 0; i < Ks.size(); ++i) {
+		_renderCam.intrin = Intrinsic(Ks[i].data());
+		_renderCam.extrin = Extrinsic(Ms[i].data(), w2c, yIsUp);
+
+		// every pose gets its own selection, independent of the others
+		FrameState &state = _frameStates[_front];
+		PrepareFrame(_renderCam, _mode, _fixRef, _stateVersion, Selection(), 
+			state);
+		_Draw(state);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 
+			rgbas[i].data());
+
+		// GL rows start at the bottom
+		uint8_t *image = rgbas[i].data();
+		for (int y = 0; y < height / 2; ++y) {
+			uint8_t *top = image + y * rowSize;
+			uint8_t *bottom = image + (height - 1 - y) * rowSize;
+			std::memcpy(row.data(), top, rowSize);
+			std::memcpy(top, bottom, rowSize);
+			std::memcpy(bottom, row.data(), rowSize);
+		}
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	// restore, the scene texture no longer holds the interactive frame
+	_renderCam = renderCam;
+	_mode = mode;
+	_screenViewport = screenViewport;
+	_offlineViewport = offlineViewport;
+	_poster->SetRegion(static_cast<float>(offlineViewport[2]) / width,
+		static_cast<float>(offlineViewport[3]) / height);
+	_poster->SetScreenFBO(screenFBO);
+	_frameStates[0].valid = _frameStates[1].valid = false;
+	_frameValid = false;
+
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteRenderbuffers(1, &rbo);
+
+	return true;
 }
 
-void LFEngineImpl::VRFPS(void)
+FrameTimeStats LFEngineImpl::GetFrameTimes(const float window) const
 {
-	while (_renderer)
-	{
-		this_thread::sleep_for(chrono::seconds(1));
-		_fps = _frames;
-		_frames = 0;
-	}
+	return _clock.Summarize(window);
 }
 
 void LFEngineImpl::Resize(uint32_t width, uint32_t height)
@@ -411,8 +1032,11 @@ void LFEngineImpl::SetUI(UIType type, float sx, float sy)
 	case TOUCH:
 		_UI->Touch(sx, sy);
 		_mode = INTERP;
+		_dragging = true;
 		break;
 	case LEAVE: {
+		_dragging = false;
+
 		Extrinsic dst = _UI->Leave(sx, sy, _renderCam.extrin);
 
 		/* Move to the nearest reference camera */
@@ -428,10 +1052,14 @@ void LFEngineImpl::SetUI(UIType type, float sx, float sy)
 		throw runtime_error("Setting false UI type");
 		break;
 	}
+
+	// search for the new view while the client is busy until the next Draw
+	PrepareNext();
 }
 
 void LFEngineImpl::EnqueueSlots(const Extrinsic &start, const Extrinsic &end)
 {
+	const auto startTime = chrono::high_resolution_clock::now();
 	_slotQueue.clear();
 
 	const glm::vec3 diff = start.Pos() - end.Pos();
@@ -444,6 +1072,8 @@ void LFEngineImpl::EnqueueSlots(const Extrinsic &start, const Extrinsic &end)
 		const Extrinsic e = Interp(start, end, static_cast<float>(i) / intervals);
 		_slotQueue.push_back(e);
 	}
+
+	_slotTime += MsSince(startTime);
 }
 
 void LFEngineImpl::SetLocationOfReferenceCamera(int id)
@@ -463,6 +1093,7 @@ float LFEngineImpl::SetZoomScale(float zoom_scale)
 
 	_renderCam.intrin.fx = _stdFx * zoom_scale;
 	_renderCam.intrin.fy = _stdFy * zoom_scale;
+	PrepareNext();
 
     return zoom_scale;
 }
@@ -487,9 +1118,34 @@ bool LFEngineImpl::GetScreenShot(unsigned char *buffer, int x, int y, int width,
 	return true;
 }
 
+void LFEngineImpl::SetScreenShotSink(ScreenShotSinkFunc sink, void *user)
+{
+	_shotSink = sink;
+	_shotUser = user;
+}
+
+bool LFEngineImpl::QueueScreenShot(int x, int y, int width, int height)
+{
+	if (!_readback || !_poster) {
+		RETURN_ON_ERROR("Scene is not set");
+	}
+
+	return _readback->Queue(_poster->ScreenFBO(), x, y, width, height, 
+		_shotSink, _shotUser);
+}
+
+size_t LFEngineImpl::FlushScreenShots(bool wait)
+{
+	if (!_readback) {
+		return 0;
+	}
+
+	return _readback->Poll(_shotSink, _shotUser, wait);
+}
+
 bool LFEngineImpl::SetBackground(float r, float g, float b)
 {
-	if (!_textureFuser) {
+	if (!_poster) {
 		return false;
 	}
 
@@ -497,15 +1153,16 @@ bool LFEngineImpl::SetBackground(float r, float g, float b)
 	float _g = std::max<float>(std::min<float>(g, 1.0f), 0.0f);
 	float _b = std::max<float>(std::min<float>(b, 1.0f), 0.0f);
 
-	_textureFuser->SetBackground(_r, _g, _b);
+	_poster->SetBackground(_r, _g, _b);
 	
+	++_stateVersion;
 	return true;
 }
 
 bool LFEngineImpl::SetBackground(const string &imagePath)
 {
-	if (!_textureFuser) {
-		RETURN_ON_ERROR("texture fuser is NULL");
+	if (!_poster) {
+		RETURN_ON_ERROR("poster is NULL");
 	}
 	if (!fdi || !fdh) {
 		RETURN_ON_ERROR("Decoding functions are not registered");
@@ -518,26 +1175,28 @@ bool LFEngineImpl::SetBackground(const string &imagePath)
 		RETURN_ON_ERROR("Decode background failed");
 	}
 
-	if (!_textureFuser->SetBackground(Image(image, width, height, 3))) {
+	if (!_poster->SetBackground(Image(image, width, height, 3))) {
 		RETURN_ON_ERROR("Set background failed");
 	}
 
+	++_stateVersion;
 	return true;
 }
 
 bool LFEngineImpl::SetBackground(const uint8_t *bg, const int width, const int height)
 {
-	if (!_textureFuser) {
-		RETURN_ON_ERROR("texture fuser is NULL");
+	if (!_poster) {
+		RETURN_ON_ERROR("poster is NULL");
 	}
 
 	shared_ptr<uint8_t> image(new uint8_t[width*height * 3]);
 	std::memcpy(image.get(), bg, width * height * 3);
 
-	if (!_textureFuser->SetBackground(Image(image, width, height, 3))) {
+	if (!_poster->SetBackground(Image(image, width, height, 3))) {
 		RETURN_ON_ERROR("Set background failed");
 	}
 
+	++_stateVersion;
 	return true;
 }
 
@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+
+#include "MeshSimplifier.h"
+
+#include "glm/glm.hpp"
+
+using std::unordered_map;
+
+// open edges weigh this much more than faces, so borders of the mesh keep
+// their outline while its surface is simplified
+static const double BOUNDARY_WEIGHT = 10.0;
+
+// collapses are ordered by their error plus this fraction of the squared
+// edge length. Flat regions then shrink evenly instead of all collapsing
+// onto one vertex, which makes slivers and slows down later collapses.
+static const double LENGTH_WEIGHT = 0.01;
+
+// symmetric 4x4 matrix summing squared distances to a set of planes
+struct Quadric
+{
+	double a[10];
+
+	Quadric() { std::fill(a, a + 10, 0.0); }
+
+	void AddPlane(const glm::dvec3 &n, const double d, const double w)
+	{
+		a[0] += w * n.x * n.x; a[1] += w * n.x * n.y; a[2] += w * n.x * n.z;
+		a[3] += w * n.x * d; a[4] += w * n.y * n.y; a[5] += w * n.y * n.z;
+		a[6] += w * n.y * d; a[7] += w * n.z * n.z; a[8] += w * n.z * d;
+		a[9] += w * d * d;
+	}
+
+	Quadric& operator+=(const Quadric &q)
+	{
+		for (int i = 0; i < 10; ++i) a[i] += q.a[i];
+		return *this;
+	}
+
+	double Error(const glm::dvec3 &p) const
+	{
+		const double x = p.x, y = p.y, z = p.z;
+		return a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x
+			+ a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y
+			+ a[7] * z * z + 2 * a[8] * z + a[9];
+	}
+};
+
+// moving vertex *from* onto *to*. Valid while neither vertex changed since
+// it was queued (their stamps still match).
+struct Collapse
+{
+	double cost;			// order in the queue
+	double error;			// quadric error
+	int from;
+	int to;
+	uint32_t stampFrom;
+	uint32_t stampTo;
+
+	bool operator>(const Collapse &c) const { return cost > c.cost; }
+};
+
+struct Position
+{
+	float p[3];
+
+	bool operator==(const Position &o) const { return memcmp(p, o.p, sizeof(p)) == 0; }
+};
+
+struct PositionHash
+{
+	size_t operator()(const Position &pos) const
+	{
+		uint32_t bits[3];
+		memcpy(bits, pos.p, sizeof(bits));
+		return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+	}
+};
+
+void SimplifyMesh(const float *v, const size_t nVerts, const int *f,
+	const size_t nIndices, const vector<size_t> &targets, 
+	vector<vector<int>> &levels, vector<float> &errors)
+{
+	auto P = [v](const int i) {
+		return glm::dvec3(v[3 * i], v[3 * i + 1], v[3 * i + 2]);
+	};
+
+	// vertices sharing a position collapse together, or seams would open
+	vector<int> weld(nVerts);
+	{
+		unordered_map<Position, int, PositionHash> first(nVerts);
+		for (size_t i = 0; i < nVerts; ++i) {
+			const Position pos = { { v[3 * i], v[3 * i + 1], v[3 * i + 2] } };
+			weld[i] = first.emplace(pos, static_cast<int>(i)).first->second;
+		}
+	}
+
+	// triangles over welded vertices, without degenerate or invalid ones
+	vector<int> tris;
+	tris.reserve(nIndices);
+	for (size_t i = 0; i + 2 < nIndices; i += 3) {
+		if (f[i] < 0 || f[i + 1] < 0 || f[i + 2] < 0 || size_t(f[i]) >= nVerts ||
+			size_t(f[i + 1]) >= nVerts || size_t(f[i + 2]) >= nVerts) {
+			continue;
+		}
+		const int a = weld[f[i]], b = weld[f[i + 1]], c = weld[f[i + 2]];
+		if (a == b || b == c || c == a) continue;
+		tris.push_back(a);
+		tris.push_back(b);
+		tris.push_back(c);
+	}
+	const size_t nTris = tris.size() / 3;
+
+	// every vertex starts with the planes of the faces around it
+	vector<Quadric> quadrics(nVerts);
+	vector<vector<int>> faces(nVerts);			// faces around each vertex
+	vector<glm::dvec3> normals(nTris);			// unit face normals
+	for (size_t t = 0; t < nTris; ++t) {
+		const int *tri = &tris[3 * t];
+		const glm::dvec3 p0 = P(tri[0]);
+		const glm::dvec3 n = glm::cross(P(tri[1]) - p0, P(tri[2]) - p0);
+		const double len = glm::length(n);
+
+		for (int k = 0; k < 3; ++k) {
+			faces[tri[k]].push_back(static_cast<int>(t));
+		}
+		if (len == 0.0) continue;
+
+		normals[t] = n / len;
+		for (int k = 0; k < 3; ++k) {
+			quadrics[tri[k]].AddPlane(normals[t], -glm::dot(normals[t], p0), 1.0);
+		}
+	}
+
+	// collect edges from the faces around each of their vertices. Open 
+	// edges (with a single face) are held by planes standing on them, 
+	// perpendicular to their face.
+	vector<std::pair<int, int>> edges;
+	vector<std::pair<int, int>> around;		// (neighbor, face) of a vertex
+	for (size_t a = 0; a < nVerts; ++a) {
+		around.clear();
+		for (const int t : faces[a]) {
+			const int *tri = &tris[3 * t];
+			const int k = tri[0] == int(a) ? 0 : (tri[1] == int(a) ? 1 : 2);
+			around.emplace_back(tri[(k + 1) % 3], t);
+			around.emplace_back(tri[(k + 2) % 3], t);
+		}
+		std::sort(around.begin(), around.end());
+
+		for (size_t i = 0; i < around.size(); ) {
+			size_t j = i + 1;
+			while (j < around.size() && around[j].first == around[i].first) ++j;
+
+			const int b = around[i].first;
+			const bool open = (j - i == 1);
+			i = j;
+			if (b < int(a)) continue;
+
+			edges.emplace_back(static_cast<int>(a), b);
+			const glm::dvec3 n = open ? 
+				glm::cross(P(b) - P(a), normals[around[j - 1].second]) : glm::dvec3(0.0);
+			const double len = glm::length(n);
+			if (len != 0.0) {
+				const glm::dvec3 bn = n / len;
+				quadrics[a].AddPlane(bn, -glm::dot(bn, P(a)), BOUNDARY_WEIGHT);
+				quadrics[b].AddPlane(bn, -glm::dot(bn, P(a)), BOUNDARY_WEIGHT);
+			}
+		}
+	}
+
+	// queue the cheaper direction of every edge
+	vector<uint32_t> stamps(nVerts, 0);
+	auto Cheaper = [&](const int a, const int b) {
+		Quadric q = quadrics[a];
+		q += quadrics[b];
+		const double ab = std::max(q.Error(P(b)), 0.0);
+		const double ba = std::max(q.Error(P(a)), 0.0);
+		const double length = LENGTH_WEIGHT * glm::dot(P(b) - P(a), P(b) - P(a));
+		return ab <= ba ? Collapse{ ab + length, ab, a, b, stamps[a], stamps[b] } :
+			Collapse{ ba + length, ba, b, a, stamps[b], stamps[a] };
+	};
+	vector<Collapse> queued;
+	queued.reserve(edges.size());
+	for (const auto &e : edges) {
+		queued.push_back(Cheaper(e.first, e.second));
+	}
+	vector<std::pair<int, int>>().swap(edges);
+	std::priority_queue<Collapse, vector<Collapse>, std::greater<Collapse>> heap(
+		std::greater<Collapse>(), std::move(queued));
+
+	// a collapse must not turn any remaining face around
+	vector<bool> removed(nTris, false);
+	auto Flips = [&](const Collapse &c) {
+		const glm::dvec3 pTo = P(c.to);
+		for (const int t : faces[c.from]) {
+			if (removed[t]) continue;
+
+			const int *tri = &tris[3 * t];
+			if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) continue;
+
+			glm::dvec3 p[3], q[3];
+			for (int k = 0; k < 3; ++k) {
+				p[k] = P(tri[k]);
+				q[k] = tri[k] == c.from ? pTo : p[k];
+			}
+			const glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+			const glm::dvec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+			if (glm::dot(before, before) == 0.0) continue;
+			if (glm::dot(before, after) <= 0.0) return true;
+		}
+		return false;
+	};
+
+	// store the remaining faces as the next level whenever they reach its
+	// target
+	levels.assign(targets.size(), vector<int>());
+	errors.assign(targets.size(), 0.f);
+	size_t live = tris.size();
+	double maxError = 0.0;
+	vector<int> neighbors;
+	for (size_t level = 0; level < targets.size(); ++level) {
+		while (live > targets[level] && !heap.empty()) {
+			const Collapse c = heap.top();
+			heap.pop();
+			if (c.stampFrom != stamps[c.from] || c.stampTo != stamps[c.to] || 
+				Flips(c)) {
+				continue;
+			}
+
+			// faces on the edge vanish, the others follow *from* onto *to*
+			for (const int t : faces[c.from]) {
+				if (removed[t]) continue;
+
+				int *tri = &tris[3 * t];
+				if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) {
+					removed[t] = true;
+					live -= 3;
+					continue;
+				}
+				for (int k = 0; k < 3; ++k) {
+					if (tri[k] == c.from) tri[k] = c.to;
+				}
+				faces[c.to].push_back(t);
+			}
+			vector<int>().swap(faces[c.from]);
+			quadrics[c.to] += quadrics[c.from];
+			++stamps[c.from];
+			++stamps[c.to];
+			maxError = std::max(maxError, c.error);
+
+			// edges around *to* changed their cost
+			vector<int> &ring = faces[c.to];
+			ring.erase(std::remove_if(ring.begin(), ring.end(),
+				[&removed](const int t) { return removed[t]; }), ring.end());
+			neighbors.clear();
+			for (const int t : ring) {
+				for (int k = 0; k < 3; ++k) {
+					if (tris[3 * t + k] != c.to) neighbors.push_back(tris[3 * t + k]);
+				}
+			}
+			std::sort(neighbors.begin(), neighbors.end());
+			neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), 
+				neighbors.end());
+			for (const int w : neighbors) {
+				heap.push(Cheaper(c.to, w));
+			}
+		}
+
+		levels[level].reserve(live);
+		for (size_t t = 0; t < nTris; ++t) {
+			if (!removed[t]) {
+				levels[level].insert(levels[level].end(), &tris[3 * t], &tris[3 * t + 3]);
+			}
+		}
+		errors[level] = static_cast<float>(std::sqrt(maxError));
+	}
+}
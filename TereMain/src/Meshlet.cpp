@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+#include "Meshlet.h"
+#include "Const.h"
+
+// spread the low 10 bits of x to every third bit
+static uint32_t SpreadBits(uint32_t x)
+{
+	x &= 0x3ff;
+	x = (x | (x << 16)) & 0x30000ff;
+	x = (x | (x << 8)) & 0x300f00f;
+	x = (x | (x << 4)) & 0x30c30c3;
+	x = (x | (x << 2)) & 0x9249249;
+	return x;
+}
+
+void BuildMeshlets(const float *v, int *f, const size_t nIndices,
+	const size_t first, vector<Meshlet> &meshlets)
+{
+	const size_t nFaces = nIndices / 3;
+	if (nFaces == 0) {
+		return;
+	}
+
+	auto P = [v](const int i) {
+		return glm::vec3(v[3 * i], v[3 * i + 1], v[3 * i + 2]);
+	};
+
+	// bounds of the face centroids
+	glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+	for (size_t t = 0; t < nFaces; ++t) {
+		const glm::vec3 c = (P(f[3 * t]) + P(f[3 * t + 1]) + P(f[3 * t + 2])) / 3.f;
+		lo = glm::min(lo, c);
+		hi = glm::max(hi, c);
+	}
+	const glm::vec3 extent = glm::max(hi - lo, glm::vec3(FLT_MIN));
+
+	// faces are ordered by the axis their normal is closest to, then along a
+	// Morton curve through their centroids
+	vector<std::pair<uint64_t, uint32_t>> keys(nFaces);
+	for (size_t t = 0; t < nFaces; ++t) {
+		const glm::vec3 p0 = P(f[3 * t]), p1 = P(f[3 * t + 1]), p2 = P(f[3 * t + 2]);
+		const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+		const glm::vec3 a = glm::abs(n);
+		const int axis = a.x >= a.y && a.x >= a.z ? 0 : (a.y >= a.z ? 1 : 2);
+		const uint64_t facing = 2 * axis + (n[axis] < 0.f ? 1 : 0);
+
+		const glm::vec3 q = ((p0 + p1 + p2) / 3.f - lo) / extent * 1023.f;
+		const uint32_t morton = SpreadBits(uint32_t(q.x)) |
+			(SpreadBits(uint32_t(q.y)) << 1) | (SpreadBits(uint32_t(q.z)) << 2);
+		keys[t] = std::make_pair((facing << 30) | morton, static_cast<uint32_t>(t));
+	}
+	std::sort(keys.begin(), keys.end());
+
+	vector<int> sorted(nFaces * 3);
+	for (size_t t = 0; t < nFaces; ++t) {
+		std::copy(f + 3 * keys[t].second, f + 3 * keys[t].second + 3, &sorted[3 * t]);
+	}
+	std::copy(sorted.begin(), sorted.end(), f);
+
+	for (size_t begin = 0; begin < nFaces; begin += MESHLET_FACES) {
+		const size_t end = std::min(begin + MESHLET_FACES, nFaces);
+
+		Meshlet m;
+		m.first = first + 3 * begin;
+		m.count = 3 * (end - begin);
+
+		// sphere around the bounding box of the faces
+		glm::vec3 mlo(FLT_MAX), mhi(-FLT_MAX);
+		for (size_t i = 3 * begin; i < 3 * end; ++i) {
+			mlo = glm::min(mlo, P(f[i]));
+			mhi = glm::max(mhi, P(f[i]));
+		}
+		m.center = (mlo + mhi) * 0.5f;
+		m.radius = 0.f;
+		for (size_t i = 3 * begin; i < 3 * end; ++i) {
+			m.radius = std::max(m.radius, glm::length(P(f[i]) - m.center));
+		}
+
+		// cone around the mean face normal
+		vector<glm::vec3> normals;
+		normals.reserve(end - begin);
+		glm::vec3 sum(0.f);
+		for (size_t t = begin; t < end; ++t) {
+			const glm::vec3 p0 = P(f[3 * t]);
+			const glm::vec3 n = glm::cross(P(f[3 * t + 1]) - p0, P(f[3 * t + 2]) - p0);
+			const float len = glm::length(n);
+			if (len == 0.f) continue;
+
+			normals.push_back(n / len);
+			sum += normals.back();
+		}
+		const float sumLen = glm::length(sum);
+		m.axis = sumLen > 0.f ? sum / sumLen : glm::vec3(0.f, 0.f, 1.f);
+		float minDot = sumLen > 0.f ? 1.f : -1.f;
+		for (const glm::vec3 &n : normals) {
+			minDot = std::min(minDot, glm::dot(n, m.axis));
+		}
+
+		// no cosine reaches 2, so wide cones are never culled
+		m.cutoff = minDot > 0.f ? std::sqrt(1.f - minDot * minDot) : 2.f;
+
+		meshlets.push_back(m);
+	}
+}
+
+void FrustumPlanes(const glm::mat4 &MVP, glm::vec4 planes[6])
+{
+	const glm::mat4 T = glm::transpose(MVP);
+	planes[0] = T[3] + T[0];		// left
+	planes[1] = T[3] - T[0];		// right
+	planes[2] = T[3] + T[1];		// bottom
+	planes[3] = T[3] - T[1];		// top
+	planes[4] = T[3] + T[2];		// near
+	planes[5] = T[3] - T[2];		// far
+
+	for (int i = 0; i < 6; ++i) {
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+	}
+}
+
+bool MeshletVisible(const Meshlet &m, const glm::vec4 planes[6],
+	const glm::vec3 &eye, const bool backface)
+{
+	for (int i = 0; i < 6; ++i) {
+		if (glm::dot(glm::vec3(planes[i]), m.center) + planes[i].w < -m.radius) {
+			return false;
+		}
+	}
+
+	// every face turns away when the direction towards the sphere is closer
+	// to the axis than 90 degrees less the cone's half angle, by more than 
+	// the angle the sphere covers
+	if (backface) {
+		const glm::vec3 d = m.center - eye;
+		const float dist = glm::length(d);
+		if (dist > m.radius && glm::dot(d, m.axis) >= m.cutoff * dist + m.radius) {
+			return false;
+		}
+	}
+
+	return true;
+}
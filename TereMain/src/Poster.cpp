@@ -11,10 +11,23 @@ using std::runtime_error;
 
 Poster::Poster()
 	: _texture(0),
+	_regionX(1.f),
+	_regionY(1.f),
+	_linearSampler(0),
+	_monochromatic(true),
+	_bgTexture(0),
+	_bgR(0.f),
+	_bgG(0.f),
+	_bgB(0.f),
 	_program(0),
 	_vertexArray(0),
 	_vertexBuffer(0),
 	_elementBuffer(0),
+	_imageLocation(-1),
+	_bgColorLocation(-1),
+	_bgTextureLocation(-1),
+	_monochromaticLocation(-1),
+	_regionLocation(-1),
     _fbo(0)
 {
 	Init();
@@ -26,10 +39,23 @@ Poster::Poster()
 
 Poster::Poster(unsigned int texture)
 	: _texture(texture),
+	_regionX(1.f),
+	_regionY(1.f),
+	_linearSampler(0),
+	_monochromatic(true),
+	_bgTexture(0),
+	_bgR(0.f),
+	_bgG(0.f),
+	_bgB(0.f),
 	_program(0),
 	_vertexArray(0),
 	_vertexBuffer(0),
 	_elementBuffer(0),
+	_imageLocation(-1),
+	_bgColorLocation(-1),
+	_bgTextureLocation(-1),
+	_monochromaticLocation(-1),
+	_regionLocation(-1),
     _fbo(0)
 {
 	Init();
@@ -45,6 +71,8 @@ Poster::~Poster()
 	glDeleteVertexArrays(1, &_vertexArray);
 	glDeleteBuffers(1, &_vertexBuffer);
 	glDeleteBuffers(1, &_elementBuffer);
+	glDeleteSamplers(1, &_linearSampler);
+	DestroyTexture(_bgTexture);
 }
 
 
@@ -66,11 +94,30 @@ bool Poster::Render(const vector<int>& viewport) const
 	glBindTexture(GL_TEXTURE_2D, _texture);
 	glUniform1i(_imageLocation, 0);
 
+	// a scaled scene is smoothed, a full one stays pixel exact
+	const bool scaled = _regionX < 1.f || _regionY < 1.f;
+	glUniform2f(_regionLocation, _regionX, _regionY);
+	glBindSampler(0, scaled ? _linearSampler : 0);
+
+	// blend background 
+	glUniform1i(_monochromaticLocation, static_cast<int>(_monochromatic));
+	if (_monochromatic) {
+		glUniform3f(_bgColorLocation, _bgR, _bgG, _bgB);
+	}
+	else {
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, _bgTexture);
+		glUniform1i(_bgTextureLocation, 1);
+	}
+
 	glBindVertexArray(_vertexArray);
 	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 	glBindVertexArray(0);
 
 	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindSampler(0, 0);
 	glUseProgram(0);
 
 	return true;
@@ -85,6 +132,12 @@ bool Poster::SetTexture(unsigned int texture)
 	return true;
 }
 
+void Poster::SetRegion(const float sx, const float sy)
+{
+	_regionX = sx;
+	_regionY = sy;
+}
+
 bool Poster::IsConsistent() const
 {
 	if (_program <= 0) {
@@ -99,7 +152,16 @@ bool Poster::IsConsistent() const
 	if (_elementBuffer <= 0) {
 		return false;
 	}
-	if (_imageLocation < 0) {
+	if (_imageLocation < 0 || _regionLocation < 0) {
+		return false;
+	}
+	if (_linearSampler <= 0) {
+		return false;
+	}
+	if (_monochromatic && _bgColorLocation < 0) {
+		return false;
+	}
+	if (!_monochromatic && _bgTextureLocation < 0) {
 		return false;
 	}
 	return true;
@@ -114,6 +176,17 @@ void Poster::Init()
 
 	// get uniform location
 	_imageLocation = glGetUniformLocation(_program, "image");
+	_bgColorLocation = glGetUniformLocation(_program, "bgColor");
+	_bgTextureLocation = glGetUniformLocation(_program, "bgTexture");
+	_monochromaticLocation = glGetUniformLocation(_program, "monochromatic");
+	_regionLocation = glGetUniformLocation(_program, "region");
+
+	// upsamples scenes rendered at reduced resolution
+	glGenSamplers(1, &_linearSampler);
+	glSamplerParameteri(_linearSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glSamplerParameteri(_linearSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glSamplerParameteri(_linearSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glSamplerParameteri(_linearSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
 	// generate vertex buffer
 	float vertices[] = {
@@ -151,6 +224,35 @@ void Poster::Init()
 	glBindVertexArray(0);
 }
 
+bool Poster::SetBackground(const float r, const float g, const float b)
+{
+	_bgR = r;
+	_bgG = g;
+	_bgB = b;
+
+	// delete background texture is any
+	DestroyTexture(_bgTexture);
+
+	_monochromatic = true;
+	return true;
+}
+
+bool Poster::SetBackground(const Image &I)
+{
+	unsigned int tex = GetTextureFromImage(I.data.get(), I.width, I.height, I.chn);
+
+	if (tex == 0) {
+		return false;
+	}
+
+	// delete background texture is any
+	DestroyTexture(_bgTexture);
+
+	_bgTexture = tex;
+	_monochromatic = false;
+	return true;
+}
+
 void Poster::SetScreenFBO(unsigned int fbo)
 {
     _fbo = fbo;
@@ -0,0 +1,110 @@
+#include "Readback.h"
+#include "Error.h"
+
+Readback::Readback()
+	: _head(0),
+	_count(0),
+	_nextId(0)
+{
+	for (auto &slot : _slots) {
+		glGenBuffers(1, &slot.pbo);
+		slot.size = 0;
+		slot.fence = 0;
+		slot.width = slot.height = 0;
+		slot.id = 0;
+	}
+}
+
+Readback::~Readback()
+{
+	for (auto &slot : _slots) {
+		if (slot.fence) glDeleteSync(slot.fence);
+		glDeleteBuffers(1, &slot.pbo);
+	}
+}
+
+bool Readback::Queue(unsigned int fbo, int x, int y, int width, int height,
+	ScreenShotSinkFunc sink, void *user)
+{
+	if (x < 0 || y < 0 || width <= 0 || height <= 0) {
+		RETURN_ON_ERROR("Invalid readback region");
+	}
+
+	// ring is full, make room
+	if (_count == NUM_SLOTS) {
+		Deliver(sink, user);
+	}
+
+	Slot &slot = _slots[(_head + _count) % NUM_SLOTS];
+	const size_t size = static_cast<size_t>(width) * height * 4;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+	if (slot.size < size) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+		slot.size = size;
+	}
+
+	// with a pack buffer bound, this only queues the copy
+	glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.width = width;
+	slot.height = height;
+	slot.id = _nextId++;
+	++_count;
+
+	// make sure the fence gets submitted, Poll() does not flush
+	glFlush();
+
+	return true;
+}
+
+size_t Readback::Poll(ScreenShotSinkFunc sink, void *user, bool wait)
+{
+	size_t delivered = 0;
+
+	while (_count > 0) {
+		if (!wait) {
+			const GLenum code = glClientWaitSync(_slots[_head].fence, 0, 0);
+			if (code != GL_ALREADY_SIGNALED && code != GL_CONDITION_SATISFIED) {
+				break;
+			}
+		}
+
+		Deliver(sink, user);
+		++delivered;
+	}
+
+	return delivered;
+}
+
+void Readback::Deliver(ScreenShotSinkFunc sink, void *user)
+{
+	Slot &slot = _slots[_head];
+	const GLuint64 ONE_MS = 1000000;
+	GLenum code = GL_TIMEOUT_EXPIRED;
+
+	while (code == GL_TIMEOUT_EXPIRED) {
+		code = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, ONE_MS);
+	}
+	glDeleteSync(slot.fence);
+	slot.fence = 0;
+
+	if (sink) {
+		const size_t size = static_cast<size_t>(slot.width) * slot.height * 4;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+		const void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, 
+			GL_MAP_READ_BIT);
+		if (pixels) {
+			sink(static_cast<const uint8_t*>(pixels), slot.width, slot.height, 
+				slot.id, user);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	_head = (_head + 1) % NUM_SLOTS;
+	--_count;
+}
@@ -32,7 +32,7 @@ bool GenFrameBuffer(GLuint &fbo, GLuint &tex, GLuint &rbo,
 
 	// the depth buffer
 	glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-#if defined GL_WIN ||defined GL_OSX
+#if defined GL_WIN || defined GL_OSX || defined GL_LINUX
 	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 
 		static_cast<int>(width), static_cast<int>(height));
 #elif defined GL_IOS || defined GL_ANDROID
@@ -6,6 +6,9 @@
 #include <algorithm>
 #include <numeric>
 #include <list>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
 
 #include "glm/gtc/type_ptr.hpp"
 #include "Renderer.h"
@@ -13,13 +16,17 @@
 #include "shader/renderer_vs.h"
 #include "shader/depth_frag.h"
 #include "shader/depth_vs.h"
+#include "shader/mip_frag.h"
+#include "shader/mip_vs.h"
 
 #include "RenderUtils.h"
 #include "Error.h"
+#include "common/Log.hpp"
 #include "Const.h"
 #include "ToString.h"
 #include "camera/Intrinsic.hpp"
 #include "camera/Extrinsic.hpp"
+#include "Worker.h"
 
 #ifdef USE_CUDA
 #include "CudaUtils.h"
@@ -28,84 +35,148 @@
 using namespace glm;
 using namespace std;
 
-// generate textures for storing view-proj matrices and view matrices.
-static bool TransmitCameraToGL(const vector<Intrinsic> ins, const vector<Extrinsic> exs,
-	const float w, const float h, const float near, const float far,
-	GLuint &VPTex, GLuint &VTex)
+// block until the GPU has passed the fence, then release it
+static void WaitFence(GLsync &fence)
 {
-	if (ins.size() <= 0) {
-		RETURN_ON_ERROR("Invalid Ks");
-	}
-	if (exs.size() != ins.size()) {
-		RETURN_ON_ERROR("Invalid W2Cs");
+	if (!fence) {
+		return;
 	}
 
-	const size_t nCams = ins.size();
-	vector<glm::mat4> _viewMats(nCams);
-	vector<glm::mat4> _viewProjMats(nCams);
+	const GLuint64 ONE_MS = 1000000;
+	GLenum code = GL_TIMEOUT_EXPIRED;
 
-	/* Transfer cameras' _view matrix */
-	for (size_t i = 0; i < nCams; ++i) {
-		Extrinsic extrin = exs[i];
+	while (code == GL_TIMEOUT_EXPIRED) {
+		code = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, ONE_MS);
+	}
 
-		// calculate _view matrix
-		glm::mat4 _viewMat = extrin.viewMat;
+	glDeleteSync(fence);
+	fence = 0;
+}
 
-		// copy to _view matrices buffer
-		_viewMats[i] = _viewMat;
+// Make the buffer bound to *target* hold at least *sz* bytes. The first
+// allocation is sized exactly, later ones grow geometrically. Returns true if 
+// the storage was reallocated (contents are lost).
+static bool GrowGLBuffer(GLenum target, size_t &cap, const size_t sz)
+{
+	if (cap > 0 && sz <= cap) {
+		return false;
 	}
 
-	glGenTextures(1, &VTex);
-	glBindTexture(GL_TEXTURE_2D, VTex);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, nCams * 4, 1, 0, GL_RGBA, GL_FLOAT, _viewMats.data());
-
-	/* Transfer cameras' _view-_proj matrix */
-	for (size_t i = 0; i < nCams; ++i) {
-		Intrinsic intrin = ins[i];
+	const size_t newCap = cap > 0 ? 
+		std::max(sz, static_cast<size_t>(cap * GEOMETRY_GROWTH)) : sz;
+	glBufferData(target, newCap, NULL, GL_DYNAMIC_DRAW);
+	cap = newCap;
 
-		// calculate _proj matrix
-		glm::mat4 projMat = intrin.ProjMat(near, far, w, h);
+	return true;
+}
 
-		// copy to _view-_proj matrices buffer
-		_viewProjMats[i] = projMat * _viewMats[i];
+// number of mip levels kept for a w x h texture
+static int MipLevels(const int w, const int h)
+{
+	int levels = 1;
+	while (levels < MAX_MIP_LEVELS && (std::max(w, h) >> levels) > 0) {
+		++levels;
 	}
+	return levels;
+}
 
-	glGenTextures(1, &VPTex);
-	glBindTexture(GL_TEXTURE_2D, VPTex);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, nCams * 4, 1, 0, GL_RGBA, GL_FLOAT, _viewProjMats.data());
+// depth must not be blended across levels or texels
+static GLint MinFilter(const int levels)
+{
+	return levels > 1 ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST;
+}
 
-	return true;
+#ifndef USE_DEPTH_MAP
+// sample outside of the image returns zero depth (i.e. fails depth test)
+static void SetBorderWrap(GLenum target)
+{
+#if defined GL_WIN || defined GL_OSX || defined GL_LINUX
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+#elif defined GL_ANDROID
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER_EXT);
+	glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER_EXT);
+#elif defined GL_IOS
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+#endif
 }
+#endif /* USE_DEPTH_MAP */
 
 Renderer::Renderer(shared_ptr<TereScene> scene)
 	: _scene(scene),
 	_model(1.f),
 	_view(1.f),
-	_proj(1.f)
+	_proj(1.f),
+	_near(0.f),
+	_far(0.f),
+	_refV(scene->nCams),
+	_refVP(scene->nCams),
+	_szPosBuffer(0),
+	_szElmBuffer(0),
+	_elmType(GL_UNSIGNED_INT),
+	_uploadMBps(0.f),
+	_uploadFence(0),
+	_uploadBytes(0),
+#ifdef USE_CUDA
+	_cuPosBuffer(nullptr),
+	_cuElmBuffer(nullptr),
+#endif
+	_refreshDepth(true),
+	_staleDepth(scene->nCams, true),
+	_staleInterp(true),
+	_loaderBind(nullptr),
+	_loaderUser(nullptr),
+	_loaderVAO(0),
+	_loaderFbo(0),
+#ifdef USE_TEXTURE_ARRAY
+	_loaderAtlasFbo(0),
+#endif
+	_loadFence(0)
 {
+	_mipLevels = MipLevels(_scene->width, _scene->height);
+#ifdef USE_DEPTH_MAP
+	_depthW = std::max(1, static_cast<int>(_scene->width * DEPTH_MAP_SCALE));
+	_depthH = std::max(1, static_cast<int>(_scene->height * DEPTH_MAP_SCALE));
+	_depthLevels = MipLevels(_depthW, _depthH);
+#endif
+
 	// Assume OpenGL context is valid
 	glewExperimental = true;
-	if (glewInit() != GLEW_OK) {
+	const GLenum glewErr = glewInit();
+#if defined GL_LINUX
+	// headless (EGL) contexts have no GLX display, GL entry points are loaded
+	// nevertheless
+	if (glewErr != GLEW_OK && glewErr != GLEW_ERROR_NO_GLX_DISPLAY) {
+#else
+	if (glewErr != GLEW_OK) {
+#endif
 		THROW_ON_ERROR("glew init failed");
 	}
 
 	// Compile shaders
 	_depthShader = LoadShaders(DEPTH_VS, DEPTH_FS);
 	_sceneShader = LoadShaders(SCENE_VS, SCENE_FS);
+	_mipShader = LoadShaders(MIP_VS, MIP_FS);
 
-	// Transmit ref cameras' VP/V
-	if (!TransmitCameraToGL(_scene->intrins, _scene->extrins, _scene->width, _scene->height,
-		_scene->glnear, _scene->glfar, _VPTexture, _VTexture)) {
-		THROW_ON_ERROR("cannot transfer ref cameras' VP/V");
-	}
+	// mip levels are read with texelFetch one at a time. Without mipmap 
+	// filtering, the level being written is outside the sampled range.
+	glGenSamplers(1, &_mipSampler);
+	glSamplerParameteri(_mipSampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glSamplerParameteri(_mipSampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	// A new renderer holds nothing yet, upload everything
+	_scene->MarkDirty();
+
+	// Compute ref cameras' VP/V
+	UpdatedCameras();
+
+	// Uniform buffer for interpolation cameras' VP, refilled every frame
+	glGenBuffers(1, &_camUBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, _camUBO);
+	glBufferData(GL_UNIFORM_BUFFER, NUM_INTERP * sizeof(glm::mat4), NULL, 
+		GL_STREAM_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
 	// Transmit geometry
 	glGenVertexArrays(1, &_VAO);
@@ -114,37 +185,76 @@ Renderer::Renderer(shared_ptr<TereScene> scene)
 
 	glBindVertexArray(_VAO);
 
+	// buffers are allocated on first upload, sized to the geometry
 	glBindBuffer(GL_ARRAY_BUFFER, _posBuffer);
-	glBufferData(GL_ARRAY_BUFFER, MAX_VERTEX * BYTES_PER_VERTEX, 0, GL_DYNAMIC_DRAW);
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
 
 	if (scene->dElement) {
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _elmBuffer);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, MAX_FACE * BYTES_PER_FACE, 0, GL_DYNAMIC_DRAW);
 	}
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
 
-#ifdef USE_CUDA
-	CUDA_ERR_CHK(cudaGraphicsGLRegisterBuffer(
-		&_cuPosBuffer, _posBuffer, cudaGraphicsMapFlagsWriteDiscard));
-	if (scene->dElement) {
-		CUDA_ERR_CHK(cudaGraphicsGLRegisterBuffer(
-			&_cuElmBuffer, _elmBuffer, cudaGraphicsMapFlagsWriteDiscard));
-	}
-#endif
-
 	UpdatedGeometry();
 
 	// Transmit textures
-	glGenBuffers(1, &_PBO);
-	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _PBO);
-	glBufferData(GL_PIXEL_UNPACK_BUFFER, _scene->width * _scene->height * 3,
-		NULL, GL_DYNAMIC_DRAW);
+	glGenBuffers(NUM_PBO, _PBO);
+	for (int i = 0; i < NUM_PBO; ++i) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _PBO[i]);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, _scene->width * _scene->height * 3,
+			NULL, GL_STREAM_DRAW);
+		_PBOFence[i] = 0;
+	}
 	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 
+#ifdef USE_TEXTURE_ARRAY
+	// camera index is the layer index
+	GLint maxLayers = 0;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+	if (_scene->nCams > static_cast<size_t>(maxLayers)) {
+		THROW_ON_ERROR("Too many cameras for texture array (max %d)", maxLayers);
+	}
+
+	// rgb is sampled by the scene pass only along with separate depth maps
+#ifdef USE_DEPTH_MAP
+	const int rgbLevels = _mipLevels;
+#else
+	const int rgbLevels = 1;
+#endif
+	glGenTextures(1, &_rgbArray);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, _rgbArray);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, MinFilter(rgbLevels));
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, rgbLevels, GL_RGBA8, _scene->width, 
+		_scene->height, _scene->nCams);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+#ifdef USE_DEPTH_MAP
+	// linear depth is kept at 16 bits in a separate, smaller texture. Depth
+	// formats are renderable on every platform, unlike R16/R16F.
+	glGenTextures(1, &_depthArray);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, _depthArray);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, _depthLevels, GL_DEPTH_COMPONENT16, 
+		_depthW, _depthH, _scene->nCams);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, MinFilter(_depthLevels));
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+#else
+	glGenTextures(1, &_rgbdArray);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, _rgbdArray);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, _mipLevels, GL_RGBA8, _scene->width, 
+		_scene->height, _scene->nCams);
+	SetBorderWrap(GL_TEXTURE_2D_ARRAY);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, MinFilter(_mipLevels));
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+#endif /* USE_DEPTH_MAP */
+#else
 	_rgbTextures = vector<GLuint>(_scene->nCams);
 	_rgbdTextures = vector<GLuint>(_scene->nCams);
 	glGenTextures(_scene->nCams, _rgbTextures.data());
@@ -160,56 +270,142 @@ Renderer::Renderer(shared_ptr<TereScene> scene)
 
 	for (auto tex : _rgbdTextures) {
 		glBindTexture(GL_TEXTURE_2D, tex);
-		glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, _scene->width, _scene->height);
-#if defined GL_WIN || defined GL_OSX
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-#elif defined GL_ANDROID
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER_EXT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER_EXT);
-#elif defined GL_IOS
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-#endif
+		glTexStorage2D(GL_TEXTURE_2D, _mipLevels, GL_RGBA8, _scene->width, 
+			_scene->height);
+		SetBorderWrap(GL_TEXTURE_2D);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, MinFilter(_mipLevels));
 		glBindTexture(GL_TEXTURE_2D, 0);
 	}
+#endif /* USE_TEXTURE_ARRAY */
 
 #ifdef USE_CUDA
 	CUDA_ERR_CHK(cudaGraphicsGLRegisterBuffer(
-		&_cuPBO, _PBO, cudaGraphicsMapFlagsWriteDiscard));
+		&_cuPBO, _PBO[0], cudaGraphicsMapFlagsWriteDiscard));
 #endif
 
 	UpdatedLF();
 
 	// depth shader uniform locations
-	_dVPLct = glGetUniformLocation(_depthShader, "VP");
 	_dNearLct = glGetUniformLocation(_depthShader, "near");
 	_dFarLct = glGetUniformLocation(_depthShader, "far");
+#ifdef USE_TEXTURE_ARRAY
+	_dTileScaleLct = glGetUniformLocation(_depthShader, "tileScale");
+	GLuint bakeBlock = glGetUniformBlockIndex(_depthShader, "BakeCameras");
+	if (bakeBlock == GL_INVALID_INDEX) {
+		THROW_ON_ERROR("BakeCameras uniform block not found");
+	}
+	glUniformBlockBinding(_depthShader, bakeBlock, BAKE_UBO_BINDING);
+#else
+	_dVPLct = glGetUniformLocation(_depthShader, "VP");
+#endif
+
+	// mip shader uniform locations
+	_mSourceLct = glGetUniformLocation(_mipShader, "source");
+	_mLevelLct = glGetUniformLocation(_mipShader, "level");
+#ifdef USE_TEXTURE_ARRAY
+	_mLayerLct = glGetUniformLocation(_mipShader, "layer");
+#endif
+#ifdef USE_DEPTH_MAP
+	_mDepthPassLct = glGetUniformLocation(_mipShader, "depthPass");
+#endif
 
 	// scene shader uniform locations
 	_sNearLct = glGetUniformLocation(_sceneShader, "near");
 	_sFarLct = glGetUniformLocation(_sceneShader, "far");
-	_sNCamLct = glGetUniformLocation(_sceneShader, "N_REF_CAMERAS");
 	_sVPLct = glGetUniformLocation(_sceneShader, "VP");
-	_sVPRefLct = glGetUniformLocation(_sceneShader, "ref_cam_VP");
-	_sVRefLct = glGetUniformLocation(_sceneShader, "ref_cam_V");
 	_sNInterpLct = glGetUniformLocation(_sceneShader, "nInterps");
+	_sMaxLodLct = glGetUniformLocation(_sceneShader, "maxLod");
 	for (int i = 0; i != NUM_INTERP; ++i) {
 		string sIndex = string() + "interpIndices[" + TO_STRING(i) + "]";
 		string sWeight = string() + "interpWeights[" + TO_STRING(i) + "]";
-		string sLf = string() + "lightField[" + TO_STRING(i) + "]";
 		_sItpIdLct[i] = glGetUniformLocation(_sceneShader, sIndex.c_str());
 		_sItpWtLct[i] = glGetUniformLocation(_sceneShader, sWeight.c_str());
+#ifndef USE_TEXTURE_ARRAY
+		string sLf = string() + "lightField[" + TO_STRING(i) + "]";
 		_sLFLct[i] = glGetUniformLocation(_sceneShader, sLf.c_str());
+#endif
+	}
+#ifdef USE_TEXTURE_ARRAY
+	_sLFLct = glGetUniformLocation(_sceneShader, "lightField");
+#endif
+#ifdef USE_DEPTH_MAP
+	_sDepthLct = glGetUniformLocation(_sceneShader, "depthMap");
+	_sDepthMaxLodLct = glGetUniformLocation(_sceneShader, "depthMaxLod");
+#endif
+	GLuint camBlock = glGetUniformBlockIndex(_sceneShader, "InterpCameras");
+	if (camBlock == GL_INVALID_INDEX) {
+		THROW_ON_ERROR("InterpCameras uniform block not found");
 	}
+	glUniformBlockBinding(_sceneShader, camBlock, CAMERA_UBO_BINDING);
 
 	// generate frame buffer for scene rendering result
 	if (!GenFrameBuffer(_fbo, _cAttach, _dAttach, _scene->width, _scene->height)) {
 		THROW_ON_ERROR("Generate scene frame buffer failed\n");
 	}
 
+#ifdef USE_TEXTURE_ARRAY
+	// depth is baked into the atlas, layers are attached here to copy tiles
+	// to and to build mips
+	_rgbdDAttach = 0;
+	glGenFramebuffers(1, &_rgbdFbo);
+#ifdef USE_DEPTH_MAP
+	const GLenum none = GL_NONE;
+	glBindFramebuffer(GL_FRAMEBUFFER, _rgbdFbo);
+	glDrawBuffers(1, &none);
+	glReadBuffer(GL_NONE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+#endif
+
+	// as many cameras as fit in the atlas are baked at once
+#ifdef USE_DEPTH_MAP
+	_tileW = _depthW;
+	_tileH = _depthH;
+#else
+	_tileW = _scene->width;
+	_tileH = _scene->height;
+#endif
+	GLint maxSize = 0;
+	glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxSize);
+	maxSize = std::min(maxSize, BAKE_ATLAS_SIZE);
+	const int batch = static_cast<int>(std::min<size_t>(_scene->nCams, MAX_BAKE_BATCH));
+	_tileCols = std::max(1, std::min(batch, maxSize / _tileW));
+	_tileRows = std::max(1, std::min((batch + _tileCols - 1) / _tileCols, 
+		maxSize / _tileH));
+	_batchSize = std::min(batch, _tileCols * _tileRows);
+
+#ifdef USE_DEPTH_MAP
+	// tiles are blitted to _depthArray, which takes the same format
+	_atlasCAttach = 0;
+	glGenFramebuffers(1, &_atlasFbo);
+	glGenRenderbuffers(1, &_atlasDAttach);
+	glBindRenderbuffer(GL_RENDERBUFFER, _atlasDAttach);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, 
+		_tileCols * _tileW, _tileRows * _tileH);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, _atlasFbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, 
+		GL_RENDERBUFFER, _atlasDAttach);
+	glDrawBuffers(1, &none);
+	glReadBuffer(GL_NONE);
+	const GLenum code = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (code != GL_FRAMEBUFFER_COMPLETE) {
+		THROW_ON_ERROR("Bake atlas frame buffer is not complete! Error code: %d", code);
+	}
+#else
+	if (!GenFrameBuffer(_atlasFbo, _atlasCAttach, _atlasDAttach, 
+		_tileCols * _tileW, _tileRows * _tileH)) {
+		THROW_ON_ERROR("Generate bake atlas frame buffer failed\n");
+	}
+#endif /* USE_DEPTH_MAP */
+
+	glGenBuffers(1, &_bakeUBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, _bakeUBO);
+	glBufferData(GL_UNIFORM_BUFFER, MAX_BAKE_BATCH * (sizeof(glm::mat4) + 
+		sizeof(glm::vec4)), NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+#else
 	// generate frame buffer for depth rendering result
 	// generated texture is useless for it'll be replaced by RGBD texture in RenderDepth()
 	GLuint tempTexture = 0;
@@ -217,30 +413,55 @@ Renderer::Renderer(shared_ptr<TereScene> scene)
 		THROW_ON_ERROR("Generate depth frame buffer failed\n");
 	}
 	glDeleteTextures(1, &tempTexture);
+#endif /* USE_TEXTURE_ARRAY */
 }
 
 bool Renderer::UpdatedGeometry()
 {
+	if (!_scene->dirtyGeometry) {
+		return true;
+	}
+
 #ifdef USE_CUDA
 	size_t size = 0;
 	float* cudaData = nullptr;
 
 	assert(_scene->GPU);
 
+	// (re)register buffers with cuda whenever their storage is reallocated.
+	// Indices stay 32-bit here since they are never touched by the host.
+	glBindBuffer(GL_ARRAY_BUFFER, _posBuffer);
+	if (GrowGLBuffer(GL_ARRAY_BUFFER, _szPosBuffer, _scene->szV)) {
+		if (_cuPosBuffer) CUDA_ERR_CHK(cudaGraphicsUnregisterResource(_cuPosBuffer));
+		CUDA_ERR_CHK(cudaGraphicsGLRegisterBuffer(
+			&_cuPosBuffer, _posBuffer, cudaGraphicsMapFlagsWriteDiscard));
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
 	// Update bound cuda pos buffer
 	CUDA_ERR_CHK(cudaGraphicsMapResources(1, &_cuPosBuffer, 0));
 	CUDA_ERR_CHK(cudaGraphicsResourceGetMappedPointer((void **)&cudaData,
 		&size, _cuPosBuffer));
-	assert(_scene->szV < size);
+	assert(_scene->szV <= size);
 	CUDA_ERR_CHK(cudaMemcpy(cudaData, _scene->v, _scene->szV, cudaMemcpyDeviceToDevice));
 	CUDA_ERR_CHK(cudaGraphicsUnmapResources(1, &_cuPosBuffer, 0));
 
 	if (_scene->dElement) {
+		glBindVertexArray(_VAO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _elmBuffer);
+		if (GrowGLBuffer(GL_ELEMENT_ARRAY_BUFFER, _szElmBuffer, _scene->szF)) {
+			if (_cuElmBuffer) CUDA_ERR_CHK(cudaGraphicsUnregisterResource(_cuElmBuffer));
+			CUDA_ERR_CHK(cudaGraphicsGLRegisterBuffer(
+				&_cuElmBuffer, _elmBuffer, cudaGraphicsMapFlagsWriteDiscard));
+		}
+		glBindVertexArray(0);
+		_elmType = GL_UNSIGNED_INT;
+
 		// update bound cuda element buffer
 		CUDA_ERR_CHK(cudaGraphicsMapResources(1, &_cuElmBuffer, 0));
 		CUDA_ERR_CHK(cudaGraphicsResourceGetMappedPointer(
 			(void **)&cudaData, &size, _cuElmBuffer));
-		assert(_scene->szF < size);
+		assert(_scene->szF <= size);
 		CUDA_ERR_CHK(cudaMemcpy(cudaData, _scene->f, _scene->szF, cudaMemcpyDeviceToDevice));
 		CUDA_ERR_CHK(cudaGraphicsUnmapResources(1, &_cuElmBuffer, 0));
 	}
@@ -250,23 +471,88 @@ bool Renderer::UpdatedGeometry()
 	glBindVertexArray(_VAO);
 
 	glBindBuffer(GL_ARRAY_BUFFER, _posBuffer);
+	GrowGLBuffer(GL_ARRAY_BUFFER, _szPosBuffer, _scene->szV);
 	glBufferSubData(GL_ARRAY_BUFFER, 0, _scene->szV, _scene->v);
 
 	if (_scene->dElement) {
+		// levels of detail follow the full mesh in the same buffer
+		const vector<int> &lodF = _scene->lodF;
+		const size_t nIndices = _scene->szF / sizeof(int) + lodF.size();
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _elmBuffer);
-		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, _scene->szF, _scene->f);
+
+		// halve index bandwidth whenever every index fits in 16 bits
+		if (_scene->szV / BYTES_PER_VERTEX <= MAX_SHORT_INDEXED_VERTEX) {
+			vector<uint16_t> indices(_scene->f, _scene->f + _scene->szF / sizeof(int));
+			indices.insert(indices.end(), lodF.begin(), lodF.end());
+			GrowGLBuffer(GL_ELEMENT_ARRAY_BUFFER, _szElmBuffer, 
+				nIndices * sizeof(uint16_t));
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, 
+				nIndices * sizeof(uint16_t), indices.data());
+			_elmType = GL_UNSIGNED_SHORT;
+		}
+		else {
+			GrowGLBuffer(GL_ELEMENT_ARRAY_BUFFER, _szElmBuffer, nIndices * sizeof(int));
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, _scene->szF, _scene->f);
+			if (!lodF.empty()) {
+				glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, _scene->szF, 
+					lodF.size() * sizeof(int), lodF.data());
+			}
+			_elmType = GL_UNSIGNED_INT;
+		}
 	}
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
 #endif /* USE_CUDA */
+	_lods = _scene->lods;
+	_meshlets = _scene->meshlets;
 
+	// every depth map sees the geometry
+	std::fill(_staleDepth.begin(), _staleDepth.end(), true);
 	_refreshDepth = true;
+	_scene->dirtyGeometry = false;
+
+	return true;
+}
+
+bool Renderer::UpdatedCameras()
+{
+	// depth maps are normalized by near/far, a new range invalidates all 
+	const bool newRange = (_near != _scene->glnear || _far != _scene->glfar);
+
+	for (size_t i = 0; i < _scene->nCams; ++i) {
+		if (!newRange && !_scene->dirtyCameras[i]) {
+			continue;
+		}
+
+		_refV[i] = _scene->extrins[i].viewMat;
+		_refVP[i] = _scene->rig.VPs[i];
+		_staleDepth[i] = true;
+		_refreshDepth = true;
+		_staleInterp = true;
+		_scene->dirtyCameras[i] = false;
+	}
+
+	_near = _scene->glnear;
+	_far = _scene->glfar;
 
 	return true;
 }
 
 bool Renderer::UpdatedLF()
+{
+	vector<size_t> ids;
+	const bool uploaded = UploadImages(ids);
+
+	for (const size_t i : ids) {
+		_staleDepth[i] = true;
+		_refreshDepth = true;
+	}
+
+	return uploaded;
+}
+
+bool Renderer::UploadImages(vector<size_t> &ids)
 {
 #ifdef USE_CUDA
 	size_t size = 0;
@@ -274,7 +560,9 @@ bool Renderer::UpdatedLF()
 
 	assert(_scene->GPU);
 
-	for (size_t i = 0; i < _rgbTextures.size(); ++i) {
+	for (size_t i = 0; i < _scene->nCams; ++i) {
+		if (!_scene->dirtyImages[i]) continue;
+
 		CUDA_ERR_CHK(cudaGraphicsMapResources(1, &_cuPBO, 0));
 		CUDA_ERR_CHK(cudaGraphicsResourceGetMappedPointer((void **)&cudaData,
 			&size, _cuPBO));
@@ -282,33 +570,263 @@ bool Renderer::UpdatedLF()
 			_scene->width * _scene->height * 3, cudaMemcpyDeviceToDevice));
 		CUDA_ERR_CHK(cudaGraphicsUnmapResources(1, &_cuPBO, 0));
 
-		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _PBO);
-		glBindTexture(GL_TEXTURE_2D, _rgbTextures[i]);
-		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _scene->width, _scene->height,
-			GL_RGB, GL_UNSIGNED_BYTE, NULL);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _PBO[0]);
+		UploadImage(i);
 		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		_scene->uploadedImages[i] = true;
+		if (_scene->releaseAfterUpload) {
+			_scene->ReleaseImage(i);
+		}
+
+		ids.push_back(i);
+		_scene->dirtyImages[i] = false;
 	}
 #else
 	assert(!_scene->GPU);
 
-	for (size_t i = 0; i < _rgbTextures.size(); ++i) {
-		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _PBO);
-		glBufferSubData(GL_PIXEL_UNPACK_BUFFER, 0,
-			_scene->width * _scene->height * 3, _scene->rgbs[i]);
-		glBindTexture(GL_TEXTURE_2D, _rgbTextures[i]);
-		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _scene->width, _scene->height,
-			GL_RGB, GL_UNSIGNED_BYTE, NULL);
+	// Stream images through a ring of PBOs. While the GPU is transferring 
+	// camera i from one PBO, camera i+1 is copied into the next one. A fence
+	// guards each PBO against being overwritten before its transfer is done.
+	const size_t szImage = _scene->width * _scene->height * 3;
+	CollectUploadTime();
+	const auto start = chrono::high_resolution_clock::now();
+	size_t uploaded = 0;
+	int slot = 0;
+
+	for (size_t i = 0; i < _scene->nCams; ++i) {
+		if (!_scene->dirtyImages[i]) continue;
+
+		WaitFence(_PBOFence[slot]);
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _PBO[slot]);
+		void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, szImage,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (!dst) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			RETURN_ON_ERROR("cannot map PBO");
+		}
+		std::memcpy(dst, _scene->rgbs[i], szImage);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		_scene->uploadedImages[i] = true;
+		if (_scene->releaseAfterUpload) {
+			_scene->ReleaseImage(i);
+		}
+		UploadImage(i);
+		_PBOFence[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		slot = (slot + 1) % NUM_PBO;
+		uploaded += szImage;
+
+		ids.push_back(i);
+		_scene->dirtyImages[i] = false;
 	}
-#endif /* USE_CUDA */
 
-	_refreshDepth = true;
+	// throughput is reported once the transfers have landed. Uploads still 
+	// pending from before are measured along with these.
+	if (uploaded > 0) {
+		if (_uploadFence) {
+			glDeleteSync(_uploadFence);
+		}
+		else {
+			_uploadStart = start;
+		}
+		_uploadBytes += uploaded;
+		_uploadFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+#endif /* USE_CUDA */
 
 	return true;
 }
 
+void Renderer::CollectUploadTime()
+{
+	if (!_uploadFence || glClientWaitSync(_uploadFence, 
+		GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) {
+		return;
+	}
+	glDeleteSync(_uploadFence);
+	_uploadFence = 0;
+
+	// the end is when the fence was seen, at most a frame late
+	const auto end = chrono::high_resolution_clock::now();
+	const double sec = chrono::duration<double>(end - _uploadStart).count();
+	const double MB = _uploadBytes / (1024.0 * 1024.0);
+	_uploadMBps = static_cast<float>(MB / std::max(sec, 1e-9));
+	_uploadBytes = 0;
+	LOGI("RENDERER: uploaded %.1f MB in %.1f ms (%.1f MB/s)\n", 
+		MB, sec * 1000.0, _uploadMBps.load());
+}
+
+void Renderer::UploadImage(const size_t id)
+{
+#ifdef USE_TEXTURE_ARRAY
+	glBindTexture(GL_TEXTURE_2D_ARRAY, _rgbArray);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, id, _scene->width, 
+		_scene->height, 1, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+#else
+	glBindTexture(GL_TEXTURE_2D, _rgbTextures[id]);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _scene->width, _scene->height,
+		GL_RGB, GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+#endif
+}
+
 bool Renderer::RefreshDepth()
+{
+	vector<size_t> ids;
+	for (size_t i = 0; i < _scene->nCams; ++i) {
+		if (_staleDepth[i]) ids.push_back(i);
+	}
+
+#ifdef USE_TEXTURE_ARRAY
+	if (!BakeDepth(ids, _VAO, _rgbdFbo, _atlasFbo)) {
+#else
+	if (!BakeDepth(ids, _VAO, _rgbdFbo)) {
+#endif
+		return false;
+	}
+
+	std::fill(_staleDepth.begin(), _staleDepth.end(), false);
+	_refreshDepth = false;
+	return true;
+}
+
+#ifdef USE_TEXTURE_ARRAY
+bool Renderer::BakeDepth(const vector<size_t> &ids, GLuint vao, GLuint fbo,
+	GLuint atlasFbo)
+{
+	// cameras drawing the same level of detail share batches
+	vector<std::pair<size_t, size_t>> order;		// (level, id)
+	order.reserve(ids.size());
+	for (const size_t i : ids) {
+		size_t level = 0;
+		if (!_scene->lodFullDepth) {
+			const glm::mat4 P = _refVP[i] * glm::inverse(_refV[i]);
+			level = PickLod(_refV[i], P, _tileH);
+		}
+		order.emplace_back(level, i);
+	}
+	std::sort(order.begin(), order.end());
+
+	const int atlasW = _tileCols * _tileW;
+	const int atlasH = _tileRows * _tileH;
+
+	// set up before rendering depth
+	glUseProgram(_depthShader);
+	glUniform1f(_dNearLct, _scene->glnear);
+	glUniform1f(_dFarLct, _scene->glfar);
+	glUniform2f(_dTileScaleLct, 1.f / _tileCols, 1.f / _tileRows);
+	glBindBufferBase(GL_UNIFORM_BUFFER, BAKE_UBO_BINDING, _bakeUBO);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, _rgbArray);
+	glBindVertexArray(vao);
+	glEnable(GL_DEPTH_TEST);
+	glClearColor(0, 0, 0, 0);
+#if defined GL_WIN || defined GL_OSX || defined GL_LINUX
+	for (int k = 0; k < 4; ++k) {
+		glEnable(GL_CLIP_DISTANCE0 + k);
+	}
+#endif
+
+	glm::mat4 VPs[MAX_BAKE_BATCH];
+	glm::vec4 tiles[MAX_BAKE_BATCH];
+	for (size_t begin = 0; begin < order.size(); ) {
+		const size_t level = order[begin].first;
+		size_t end = begin + 1;
+		while (end < order.size() && end - begin < _batchSize && 
+			order[end].first == level) {
+			++end;
+		}
+		const size_t n = end - begin;
+
+		for (size_t k = 0; k < n; ++k) {
+			const size_t i = order[begin + k].second;
+			const int col = static_cast<int>(k) % _tileCols;
+			const int row = static_cast<int>(k) / _tileCols;
+			VPs[k] = _refVP[i];
+			tiles[k] = glm::vec4((2.f * col + 1.f) / _tileCols - 1.f, 
+				(2.f * row + 1.f) / _tileRows - 1.f, static_cast<float>(i), 0.f);
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, _bakeUBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, n * sizeof(glm::mat4), VPs);
+		glBufferSubData(GL_UNIFORM_BUFFER, MAX_BAKE_BATCH * sizeof(glm::mat4), 
+			n * sizeof(glm::vec4), tiles);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+		// clear only the tiles of this batch: its full rows, then what the
+		// last row holds. A full atlas keeps the unscissored fast clear.
+		glBindFramebuffer(GL_FRAMEBUFFER, atlasFbo);
+		const int fullRows = static_cast<int>(n) / _tileCols;
+		const int lastCols = static_cast<int>(n) % _tileCols;
+		if (fullRows == _tileRows) {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
+		else {
+			glEnable(GL_SCISSOR_TEST);
+			if (fullRows > 0) {
+				glScissor(0, 0, atlasW, fullRows * _tileH);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			}
+			if (lastCols > 0) {
+				glScissor(0, fullRows * _tileH, lastCols * _tileW, _tileH);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			}
+			glDisable(GL_SCISSOR_TEST);
+		}
+
+		// render depth of the whole batch
+		glViewport(0, 0, atlasW, atlasH);
+		DrawGeometry(level, static_cast<GLsizei>(n));
+
+		// copy the tiles to their layers
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, atlasFbo);
+#ifdef USE_DEPTH_MAP
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+#else
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, _rgbdArray);
+#endif
+		for (size_t k = 0; k < n; ++k) {
+			const GLint i = static_cast<GLint>(order[begin + k].second);
+			const int x = (static_cast<int>(k) % _tileCols) * _tileW;
+			const int y = (static_cast<int>(k) / _tileCols) * _tileH;
+#ifdef USE_DEPTH_MAP
+			glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, 
+				_depthArray, 0, i);
+			glBlitFramebuffer(x, y, x + _tileW, y + _tileH, 0, 0, _tileW, _tileH,
+				GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+#else
+			glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, x, y, _tileW, _tileH);
+#endif
+		}
+#ifndef USE_DEPTH_MAP
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		glActiveTexture(GL_TEXTURE0);
+#endif
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		begin = end;
+	}
+
+#if defined GL_WIN || defined GL_OSX || defined GL_LINUX
+	for (int k = 0; k < 4; ++k) {
+		glDisable(GL_CLIP_DISTANCE0 + k);
+	}
+#endif
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	glBindVertexArray(0);
+
+	for (const size_t i : ids) {
+		BuildMips(i, vao, fbo);
+	}
+
+	return true;
+}
+#else
+bool Renderer::BakeDepth(const vector<size_t> &ids, GLuint vao, GLuint fbo)
 {
 	if (_rgbTextures.size() != _scene->nCams) {
 		RETURN_ON_ERROR("_rgbTextures are invalid");
@@ -318,20 +836,12 @@ bool Renderer::RefreshDepth()
 		RETURN_ON_ERROR("_rgbdTextures are invalid");
 	}
 
-	for (size_t i = 0; i < _scene->nCams; ++i) {
-		GLuint rgb = _rgbTextures[i];
-		GLuint rgbd = _rgbdTextures[i];
-
+	// textures cannot be picked per instance, every camera is drawn alone
+	for (const size_t i : ids) {
 		// Attach rgbd texture to depth framebuffer
-		glBindFramebuffer(GL_FRAMEBUFFER, _rgbdFbo);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, rgbd, 0);
-
-		// view-proj mat
-		Intrinsic intrin(_scene->intrins[i]);
-		Extrinsic extrin(_scene->extrins[i]);
-		glm::mat4 proj = intrin.ProjMat(_scene->glnear, _scene->glfar, _scene->width, _scene->height);
-		glm::mat4 view = extrin.viewMat;
-		glm::mat4 vp = proj * view;
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 
+			_rgbdTextures[i], 0);
 
 		// set up before rendering depth
 		glUseProgram(_depthShader);
@@ -339,47 +849,410 @@ bool Renderer::RefreshDepth()
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		glEnable(GL_DEPTH_TEST);
 		glViewport(0, 0, _scene->width, _scene->height);
-		glUniformMatrix4fv(_dVPLct, 1, GL_FALSE, glm::value_ptr(vp));
+		glUniformMatrix4fv(_dVPLct, 1, GL_FALSE, glm::value_ptr(_refVP[i]));
 		glUniform1f(_dNearLct, _scene->glnear);
 		glUniform1f(_dFarLct, _scene->glfar);
 
 		// render depth
 		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, rgb);
-		glBindVertexArray(_VAO);
-		if (_scene->dElement) {
-			glDrawElements(GL_TRIANGLES, _scene->szF / sizeof(int), GL_UNSIGNED_INT, (void*)0);
+		glBindTexture(GL_TEXTURE_2D, _rgbTextures[i]);
+		glBindVertexArray(vao);
+		if (_scene->lodFullDepth) {
+			DrawGeometry(0);
 		}
-		else if (_scene->dArray) {
-			glDrawArrays(GL_TRIANGLES, 0, _scene->szV / BYTES_PER_VERTEX);
+		else {
+			const glm::mat4 P = _refVP[i] * glm::inverse(_refV[i]);
+			DrawGeometry(PickLod(_refV[i], P, _scene->height));
 		}
 
 		glBindTexture(GL_TEXTURE_2D, 0);
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 		glBindVertexArray(0);
+
+		BuildMips(i, vao, fbo);
 	}
 
-	_refreshDepth = false;
+	return true;
+}
+#endif /* USE_TEXTURE_ARRAY */
+
+size_t Renderer::PickLod(const glm::mat4 &MV, const glm::mat4 &P, 
+	const int height) const
+{
+	// errors are measured where the mesh bounds come closest to the camera
+	const glm::vec4 c = MV * glm::vec4(_scene->center, 1.f);
+	const float scale = glm::length(glm::vec3(MV[0]));
+	const float dist = std::max(-c.z - _scene->boxRadius * scale, _scene->glnear);
+	const float pixelsPerUnit = scale * 0.5f * height * P[1][1] / dist;
+
+	size_t level = 0;
+	while (level + 1 < _lods.size() && 
+		_lods[level + 1].error * pixelsPerUnit <= LOD_PIXEL_ERROR) {
+		++level;
+	}
+	return level;
+}
+
+void Renderer::DrawGeometry(const size_t level, const GLsizei instances) const
+{
+	if (_scene->dElement && level < _lods.size()) {
+		const size_t indexSize = _elmType == GL_UNSIGNED_SHORT ? 
+			sizeof(uint16_t) : sizeof(uint32_t);
+		glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(_lods[level].count),
+			_elmType, reinterpret_cast<void*>(_lods[level].first * indexSize), instances);
+	}
+	else if (_scene->dArray) {
+		glDrawArraysInstanced(GL_TRIANGLES, 0, _scene->szV / BYTES_PER_VERTEX, 
+			instances);
+	}
+}
+
+void Renderer::DrawVisible(const size_t level, const glm::mat4 &MV, 
+	const glm::mat4 &P)
+{
+	if (!_scene->dElement || level >= _lods.size() || _lods[level].nMeshlets == 0) {
+		DrawGeometry(level);
+		return;
+	}
+
+	// culling happens in model space
+	glm::vec4 planes[6];
+	FrustumPlanes(P * MV, planes);
+	const glm::vec3 eye(glm::inverse(MV)[3]);
+
+	// meshlets follow each other in the element buffer, so runs of visible 
+	// ones are drawn at once
+	const size_t indexSize = _elmType == GL_UNSIGNED_SHORT ? 
+		sizeof(uint16_t) : sizeof(uint32_t);
+	const MeshLod &lod = _lods[level];
+	size_t end = SIZE_MAX;
+	_drawCounts.clear();
+	_drawOffsets.clear();
+	for (size_t i = lod.firstMeshlet; i < lod.firstMeshlet + lod.nMeshlets; ++i) {
+		const Meshlet &m = _meshlets[i];
+		if (!MeshletVisible(m, planes, eye, _scene->cullFaces)) {
+			continue;
+		}
+
+		if (m.first == end) {
+			_drawCounts.back() += static_cast<GLsizei>(m.count);
+		}
+		else {
+			_drawCounts.push_back(static_cast<GLsizei>(m.count));
+			_drawOffsets.push_back(reinterpret_cast<const void*>(m.first * indexSize));
+		}
+		end = m.first + m.count;
+	}
+
+	if (_drawCounts.empty()) {
+		return;
+	}
+#if defined GL_WIN || defined GL_OSX || defined GL_LINUX
+	glMultiDrawElements(GL_TRIANGLES, _drawCounts.data(), _elmType, 
+		_drawOffsets.data(), static_cast<GLsizei>(_drawCounts.size()));
+#else
+	// no multi-draw in core GLES 3.0
+	for (size_t i = 0; i < _drawCounts.size(); ++i) {
+		glDrawElements(GL_TRIANGLES, _drawCounts[i], _elmType, _drawOffsets[i]);
+	}
+#endif
+}
+
+void Renderer::BuildMips(const size_t id, GLuint vao, GLuint fbo)
+{
+	if (_mipLevels < 2) {
+		return;
+	}
+
+	// any VAO serves, the mip shader reads no attributes
+	glUseProgram(_mipShader);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glBindVertexArray(vao);
+	glDisable(GL_DEPTH_TEST);
+	glActiveTexture(GL_TEXTURE0);
+	glBindSampler(0, _mipSampler);
+	glUniform1i(_mSourceLct, 0);
+#ifdef USE_TEXTURE_ARRAY
+	glUniform1i(_mLayerLct, static_cast<GLint>(id));
+#endif
+
+#ifdef USE_DEPTH_MAP
+	const GLenum color = GL_COLOR_ATTACHMENT0;
+	const GLenum none = GL_NONE;
+
+	// color levels, the depth attachment is left out
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, 0, 0, 0);
+	glDrawBuffers(1, &color);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, _rgbArray);
+	glUniform1i(_mDepthPassLct, 0);
+	for (int level = 1; level < _mipLevels; ++level) {
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, _rgbArray,
+			level, id);
+		glViewport(0, 0, std::max(1, _scene->width >> level), 
+			std::max(1, _scene->height >> level));
+		glUniform1i(_mLevelLct, level - 1);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 0, 0, 0);
+	glDrawBuffers(1, &none);
+
+	// depth levels, depth is only written with the test enabled
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_ALWAYS);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, _depthArray);
+	glUniform1i(_mDepthPassLct, 1);
+	for (int level = 1; level < _depthLevels; ++level) {
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, _depthArray,
+			level, id);
+		glViewport(0, 0, std::max(1, _depthW >> level), 
+			std::max(1, _depthH >> level));
+		glUniform1i(_mLevelLct, level - 1);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+	glDepthFunc(GL_LESS);
+#else
+	// depth lives in alpha, the depth attachment is not touched
+#ifdef USE_TEXTURE_ARRAY
+	glBindTexture(GL_TEXTURE_2D_ARRAY, _rgbdArray);
+#else
+	glBindTexture(GL_TEXTURE_2D, _rgbdTextures[id]);
+#endif
+	for (int level = 1; level < _mipLevels; ++level) {
+#ifdef USE_TEXTURE_ARRAY
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, _rgbdArray,
+			level, id);
+#else
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+			_rgbdTextures[id], level);
+#endif
+		glViewport(0, 0, std::max(1, _scene->width >> level), 
+			std::max(1, _scene->height >> level));
+		glUniform1i(_mLevelLct, level - 1);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+#endif /* USE_DEPTH_MAP */
+
+#ifdef USE_TEXTURE_ARRAY
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+#else
+	glBindTexture(GL_TEXTURE_2D, 0);
+#endif
+	glBindSampler(0, 0);
+	glBindVertexArray(0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glUseProgram(0);
+}
+
+bool Renderer::StartLoader(LoaderContextFunc bind, void *user)
+{
+#ifdef USE_CUDA
+	RETURN_ON_ERROR("background loading does not support CUDA scenes");
+#endif
+	if (!bind) {
+		RETURN_ON_ERROR("bind is NULL");
+	}
+
+	StopLoader();
+
+	// objects created so far must be visible to the loader context
+	glFlush();
+
+	bool bound = false;
+	_loader.reset(new Worker());
+	_loader->Submit([this, bind, user, &bound]() {
+		bound = bind(true, user);
+		if (!bound) {
+			return;
+		}
+
+		glGenVertexArrays(1, &_loaderVAO);
+		glBindVertexArray(_loaderVAO);
+		glBindBuffer(GL_ARRAY_BUFFER, _posBuffer);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+		if (_scene->dElement) {
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _elmBuffer);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindVertexArray(0);
+
+		glGenFramebuffers(1, &_loaderFbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, _loaderFbo);
+#ifdef USE_DEPTH_MAP
+		const GLenum none = GL_NONE;
+		glDrawBuffers(1, &none);
+		glReadBuffer(GL_NONE);
+#elif !defined USE_TEXTURE_ARRAY
+		// renderbuffers are shared, and only one context bakes at a time
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, 
+			GL_RENDERBUFFER, _rgbdDAttach);
+#endif
+
+#ifdef USE_TEXTURE_ARRAY
+		// so is the atlas
+		glGenFramebuffers(1, &_loaderAtlasFbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, _loaderAtlasFbo);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, 
+			GL_RENDERBUFFER, _atlasDAttach);
+#ifdef USE_DEPTH_MAP
+		glDrawBuffers(1, &none);
+		glReadBuffer(GL_NONE);
+#else
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 
+			_atlasCAttach, 0);
+#endif
+#endif /* USE_TEXTURE_ARRAY */
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	});
+	_loader->Wait();
+
+	if (!bound) {
+		_loader = nullptr;
+		RETURN_ON_ERROR("cannot bind loader context");
+	}
+
+	_loaderBind = bind;
+	_loaderUser = user;
+	return true;
+}
+
+void Renderer::StopLoader()
+{
+	if (!_loader) {
+		return;
+	}
+
+	_loader->Submit([this]() {
+		glDeleteFramebuffers(1, &_loaderFbo);
+#ifdef USE_TEXTURE_ARRAY
+		glDeleteFramebuffers(1, &_loaderAtlasFbo);
+#endif
+		glDeleteVertexArrays(1, &_loaderVAO);
+		glFinish();
+		_loaderBind(false, _loaderUser);
+	});
+	_loader = nullptr;
+
+	if (_loadFence) {
+		glDeleteSync(_loadFence);
+		_loadFence = 0;
+	}
+	_loadingIds.clear();
+	_loaderVAO = _loaderFbo = 0;
+#ifdef USE_TEXTURE_ARRAY
+	_loaderAtlasFbo = 0;
+#endif
+}
+
+bool Renderer::LoadLF(vector<size_t> &ids)
+{
+	ids.clear();
+
+	// a pending bake may read textures the loader would write
+	if (!_loader || !_loadingIds.empty() || _refreshDepth) {
+		return false;
+	}
+
+	for (size_t i = 0; i < _scene->nCams; ++i) {
+		if (_scene->dirtyImages[i]) ids.push_back(i);
+	}
+	if (ids.empty()) {
+		return true;
+	}
+
+	_loadingIds = ids;
+	_loader->Submit([this]() {
+		vector<size_t> uploaded;
+		if (!UploadImages(uploaded)) {
+			LOGE("[ERROR] RENDERER: background upload failed\n");
+		}
+#ifdef USE_TEXTURE_ARRAY
+		BakeDepth(uploaded, _loaderVAO, _loaderFbo, _loaderAtlasFbo);
+#else
+		BakeDepth(uploaded, _loaderVAO, _loaderFbo);
+#endif
+
+		// flushed, so the rendering thread may wait for it
+		_loadFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+	});
+
+	return true;
+}
+
+bool Renderer::PollLoader(vector<size_t> &ids, bool wait)
+{
+	if (_loadingIds.empty()) {
+		return false;
+	}
+
+	if (wait) {
+		_loader->Wait();
+		WaitFence(_loadFence);
+	}
+	else {
+		if (_loader->Busy() || 
+			glClientWaitSync(_loadFence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+			return false;
+		}
+		glDeleteSync(_loadFence);
+		_loadFence = 0;
+	}
+
+	ids.swap(_loadingIds);
+	_loadingIds.clear();
 	return true;
 }
 
 Renderer::~Renderer()
 {
+	StopLoader();
+
 	glDeleteProgram(_sceneShader);
 	glDeleteProgram(_depthShader);
+	glDeleteProgram(_mipShader);
+	glDeleteSamplers(1, &_mipSampler);
 
-	glDeleteTextures(1, &_VPTexture);
-	glDeleteTextures(1, &_VTexture);
+	glDeleteBuffers(1, &_camUBO);
 
+#if defined USE_DEPTH_MAP
+	glDeleteTextures(1, &_rgbArray);
+	glDeleteTextures(1, &_depthArray);
+#elif defined USE_TEXTURE_ARRAY
+	glDeleteTextures(1, &_rgbArray);
+	glDeleteTextures(1, &_rgbdArray);
+#else
 	glDeleteTextures(_rgbTextures.size(), _rgbTextures.data());
+	glDeleteTextures(_rgbdTextures.size(), _rgbdTextures.data());
+#endif
 
 	glDeleteFramebuffers(1, &_fbo);
 	glDeleteRenderbuffers(1, &_dAttach);
 	glDeleteTextures(1, &_cAttach);
 
+	glDeleteFramebuffers(1, &_rgbdFbo);
+	glDeleteRenderbuffers(1, &_rgbdDAttach);
+
+#ifdef USE_TEXTURE_ARRAY
+	glDeleteFramebuffers(1, &_atlasFbo);
+	glDeleteTextures(1, &_atlasCAttach);
+	glDeleteRenderbuffers(1, &_atlasDAttach);
+	glDeleteBuffers(1, &_bakeUBO);
+#endif
+
+#ifdef USE_CUDA
+	if (_cuPosBuffer) cudaGraphicsUnregisterResource(_cuPosBuffer);
+	if (_cuElmBuffer) cudaGraphicsUnregisterResource(_cuElmBuffer);
+#endif
 	glDeleteBuffers(1, &_posBuffer);
 	glDeleteBuffers(1, &_elmBuffer);
-	glDeleteBuffers(1, &_PBO);
+	for (int i = 0; i < NUM_PBO; ++i) {
+		WaitFence(_PBOFence[i]);
+	}
+	if (_uploadFence) {
+		glDeleteSync(_uploadFence);
+	}
+	glDeleteBuffers(NUM_PBO, _PBO);
 	glDeleteVertexArrays(1, &_VAO);
 }
 
@@ -390,19 +1263,33 @@ int Renderer::Render(const vector<int> &_viewport)
 		RETURN_ON_ERROR("invalid viewport");
     }
 
+	// the loader thread collects its own uploads while it is busy
+	if (_loadingIds.empty()) {
+		CollectUploadTime();
+	}
+
 	if (_refreshDepth) {
-		if (!RefreshDepth()) {
+		_depthTimer.Begin();
+		const bool refreshed = RefreshDepth();
+		_depthTimer.End();
+
+		if (!refreshed) {
 			RETURN_ON_ERROR("cannot refresh depth");
 		}
 		_refreshDepth = false;
 	}
 
+	_sceneTimer.Begin();
+
 	// bind offline framebuffer
 	glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
 	
 	/* Render scene to screen */
 	glUseProgram(_sceneShader);
 	glCullFace(GL_BACK);
+	if (_scene->cullFaces) {
+		glEnable(GL_CULL_FACE);
+	}
 	EnableMultiSample(false);
 	glEnable(GL_DEPTH_TEST);
 	glClearColor(0.f, 0.f, 0.f, 0.f);
@@ -414,24 +1301,69 @@ int Renderer::Render(const vector<int> &_viewport)
 	// Transfer uniform variables
 	glUniform1f(_sNearLct, _scene->glnear);
 	glUniform1f(_sFarLct, _scene->glfar);
-	glUniform1i(_sNCamLct, _scene->nCams);
+	glUniform1f(_sMaxLodLct, static_cast<float>(_mipLevels - 1));
+#ifdef USE_DEPTH_MAP
+	glUniform1f(_sDepthMaxLodLct, static_cast<float>(_depthLevels - 1));
+#endif
 	glUniformMatrix4fv(_sVPLct, 1, GL_FALSE, glm::value_ptr(_proj * _view * _model));
-
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, _VPTexture);
-	glUniform1i(_sVPRefLct, 0);
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, _VTexture);
-	glUniform1i(_sVRefLct, 1);
 	
     int nInterps = _interpCams.size() < NUM_INTERP ? _interpCams.size() : NUM_INTERP;
-	glUniform1i(_sNInterpLct, nInterps);
+
+	// uniforms and the camera block keep their values between frames, only
+	// slots whose camera or weight changed are sent again
+	if (_staleInterp || nInterps != int(_setInterpCams.size())) {
+		glUniform1i(_sNInterpLct, nInterps);
+	}
+	glm::mat4 interpMats[NUM_INTERP];
+	int firstMat = nInterps, lastMat = -1;	// range of changed VPs
 	for (int i = 0; i != nInterps; ++i) {
-		glUniform1i(_sItpIdLct[i], _interpCams[i].index);
-		glUniform1f(_sItpWtLct[i], _interpCams[i].weight);
+		const int camId = _interpCams[i].index;
+		if (camId >= 0) {
+			interpMats[i] = _refVP[camId];
+		}
+
+		const bool newSlot = _staleInterp || i >= int(_setInterpCams.size()) || 
+			camId != _setInterpCams[i].index;
+		if (newSlot) {
+			glUniform1i(_sItpIdLct[i], camId);
+		}
+		if (newSlot || _interpCams[i].weight != _setInterpCams[i].weight) {
+			glUniform1f(_sItpWtLct[i], _interpCams[i].weight);
+		}
+		if (!newSlot || camId < 0) {
+			continue;
+		}
+
+		firstMat = std::min(firstMat, i);
+		lastMat = i;
 	}
 
-	// Bind light field textures 
+	// Upload VP of interpolation cameras 
+	if (firstMat <= lastMat) {
+		glBindBuffer(GL_UNIFORM_BUFFER, _camUBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, firstMat * sizeof(glm::mat4), 
+			(lastMat - firstMat + 1) * sizeof(glm::mat4), interpMats + firstMat);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+	glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UBO_BINDING, _camUBO);
+
+	_setInterpCams.assign(_interpCams.begin(), _interpCams.begin() + nInterps);
+	_staleInterp = false;
+
+	// Bind light field textures, every frame since the client may change
+	// texture units between frames
+#if defined USE_DEPTH_MAP
+	glActiveTexture(GL_TEXTURE3);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, _rgbArray);
+	glUniform1i(_sLFLct, 3);
+	glActiveTexture(GL_TEXTURE4);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, _depthArray);
+	glUniform1i(_sDepthLct, 4);
+#elif defined USE_TEXTURE_ARRAY
+	glActiveTexture(GL_TEXTURE3);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, _rgbdArray);
+	glUniform1i(_sLFLct, 3);
+#else
 	for (int i = 0; i < nInterps; ++i) {
 		int camId = _interpCams[i].index;
 
@@ -440,19 +1372,18 @@ int Renderer::Render(const vector<int> &_viewport)
 		glBindTexture(GL_TEXTURE_2D, _rgbdTextures[camId]);
 		glUniform1i(_sLFLct[i], 3 + i);
 	}
+#endif
 
 	// Render scene
 	glBindVertexArray(_VAO);
-	if (_scene->dElement) {
-		glDrawElements(GL_TRIANGLES, _scene->szF / sizeof(int), GL_UNSIGNED_INT, (void*)0);
-	}
-	else if (_scene->dArray) {
-		glDrawArrays(GL_TRIANGLES, 0, _scene->szV / BYTES_PER_VERTEX);
-	}
+	DrawVisible(PickLod(_view * _model, _proj, _viewport[3]), _view * _model, _proj);
 	glBindVertexArray(0);
+	glDisable(GL_CULL_FACE);
 	glUseProgram(0);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+	_sceneTimer.End();
+
 	return _cAttach;
 }
 
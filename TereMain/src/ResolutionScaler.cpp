@@ -0,0 +1,63 @@
+#include <algorithm>
+#include <cmath>
+
+#include "ResolutionScaler.h"
+#include "Const.h"
+
+ResolutionScaler::ResolutionScaler()
+	: _budget(0.f),
+	_minScale(1.f),
+	_scale(1.f),
+	_applied(1.f),
+	_settle(0)
+{}
+
+void ResolutionScaler::SetBudget(const float ms, const float minScale)
+{
+	_budget = std::max(ms, 0.f);
+	_minScale = std::min(std::max(minScale, 0.01f), 1.f);
+	_scale = 1.f;
+	_applied = 1.f;
+	_settle = RESOLUTION_SETTLE_FRAMES;
+}
+
+float ResolutionScaler::Next(const bool interacting)
+{
+	if (!Enabled()) {
+		return 1.f;
+	}
+
+	float scale = _scale * (interacting ? INTERACTION_SCALE : 1.f);
+	scale = std::max(scale, _minScale);
+
+	// GPU timings lag a few frames behind, measure the new scale afresh
+	if (scale != _applied) {
+		_applied = scale;
+		_settle = RESOLUTION_SETTLE_FRAMES;
+	}
+
+	return _applied;
+}
+
+void ResolutionScaler::Measured(const float sceneMs, const float fixedMs)
+{
+	// no timer queries (GLES), only interaction lowers the resolution
+	if (!Enabled() || sceneMs <= 0.f) {
+		return;
+	}
+	if (_settle > 0) {
+		--_settle;
+		return;
+	}
+
+	// scene time is proportional to the number of pixels
+	const float available = std::max(_budget - std::max(fixedMs, 0.f), 
+		0.1f * _budget);
+	const float fit = _applied * std::sqrt(available / sceneMs);
+	const float scale = std::min(std::max(fit, _minScale), 1.f);
+
+	// small corrections would only churn the frame size
+	if (std::fabs(scale - _scale) >= RESOLUTION_STEP) {
+		_scale = scale;
+	}
+}
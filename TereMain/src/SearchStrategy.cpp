@@ -3,47 +3,24 @@
 #include "Strategy.h"
 
 /******************************************************************************
- *				Default searching stratergy
+ *				Kd-tree searching stratergy
  *****************************************************************************/
 
+KdSearchStrategy::KdSearchStrategy() {}
 
-DefaultSearchStrategy::DefaultSearchStrategy(const glm::vec3 &center)
-	: _center(center)
-{}
-
-vector<size_t> DefaultSearchStrategy::Search(const vector<Extrinsic> &ref,
+vector<size_t> KdSearchStrategy::Search(const CameraRig &rig,
 	const Extrinsic &rcam, const size_t maxn)
 {
-	const size_t nInterp = std::min<size_t>(ref.size(), maxn);
-	vector<float> distances;
-
-	if (nInterp == 0) {
-		return vector<size_t>();
-	}
+	const glm::vec3 p2r = glm::normalize(rcam.Pos() - rig.center);
 
-	// calculate cosine distances between virtual camera and every
-	// reference camera
-	const Extrinsic rEx(rcam);
-	const glm::vec3 &rpos = rEx.Pos();
-	const glm::vec3 &p2r = glm::normalize(rpos - _center);
+	// closest first
+	const auto best = rig.directionTree.Nearest(p2r, maxn, SIZE_MAX, 
+		&rig.eligible);
 
-	for (auto c : ref) {
-		const Extrinsic refEx(c);
-		const glm::vec3 &refPos = refEx.Pos();
-		const float dis = glm::dot(p2r, glm::normalize(refPos - _center));
-		distances.push_back(dis);
+	vector<size_t> indices(best.size());
+	for (size_t i = 0; i < best.size(); ++i) {
+		indices[i] = best[i].second;
 	}
-
-	vector<size_t> indices(ref.size());
-	std::iota(indices.begin(), indices.end(), 0);
-
-	// find reference cameras that have least cosine distances
-	std::partial_sort(indices.begin(), indices.begin() + nInterp,
-		indices.end(), [&distances](const size_t &a, const size_t &b) {
-		return distances[a] > distances[b];
-	});
-
-	indices.resize(nInterp);
 	return indices;
 }
 
@@ -53,12 +30,13 @@ vector<size_t> DefaultSearchStrategy::Search(const vector<Extrinsic> &ref,
 
 AllSearchStrategy::AllSearchStrategy() {}
 
-vector<size_t> AllSearchStrategy::Search(const vector<Extrinsic> &ref,
-	const Extrinsic &rcam, const size_t maxn)
+vector<size_t> AllSearchStrategy::Search(const CameraRig &rig,
+	const Extrinsic & /*rcam*/, const size_t maxn)
 {
 // Return all reference cameras
-	const size_t nInterp = std::min<size_t>(ref.size(), maxn);
-	vector<size_t> indices(nInterp);
-	std::iota(indices.begin(), indices.end(), 0);
+	vector<size_t> indices;
+	for (size_t i = 0; i < rig.positions.size() && indices.size() < maxn; ++i) {
+		if (rig.eligible[i]) indices.push_back(i);
+	}
 	return indices;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include <stdexcept>
 #include <chrono>
 #include <numeric>
+#include <algorithm>
 
 #include "TereScene.h"
 #include "Const.h"
@@ -21,15 +22,21 @@ TereScene::TereScene()
 	rows(0),
 	center(0.f),
 	radius(0.f),
+	boxRadius(0.f),
+	lodLevels(1),
+	lodFullDepth(true),
+	cullFaces(true),
 	v(nullptr),
-	szVBuf(MAX_VERTEX * BYTES_PER_VERTEX),
+	szVBuf(0),
 	szV(0),
 	f(nullptr),
-	szFBuf(MAX_FACE * BYTES_PER_FACE),
+	szFBuf(0),
 	szF(0),
 	GPU(false),
 	width(0),
-	height(0)
+	height(0),
+	releaseAfterUpload(false),
+	dirtyGeometry(false)
 {}
 
 TereScene::TereScene(const size_t n)
@@ -39,6 +46,55 @@ TereScene::TereScene(const size_t n)
 	intrins = vector< Intrinsic >(n);
 	extrins = vector< Extrinsic >(n);
 	rgbs = vector< uint8_t* >(n, nullptr);
+	ownImages = vector< bool >(n, false);
+	releaseFuncs = vector< ReleaseImageFunc >(n, nullptr);
+	releaseData = vector< void* >(n, nullptr);
+	uploadedImages = vector< bool >(n, false);
+	dirtyImages = vector< bool >(n, false);
+	dirtyCameras = vector< bool >(n, false);
+}
+
+// Free memory from GrowBuffer
+static void FreeBuffer(void *buf)
+{
+#ifdef USE_CUDA
+	if (buf) cudaFree(buf);
+#else
+	delete[] reinterpret_cast<uint8_t*>(buf);
+#endif
+}
+
+// Make *buf* hold at least *sz* bytes. The first allocation is sized exactly,
+// later ones grow geometrically so that slowly growing meshes do not 
+// reallocate on every update. Contents are not preserved.
+static void GrowBuffer(void **buf, size_t &cap, const size_t sz)
+{
+	if (*buf && sz <= cap) {
+		return;
+	}
+
+	const size_t newCap = *buf ? 
+		std::max(sz, static_cast<size_t>(cap * GEOMETRY_GROWTH)) : sz;
+
+	FreeBuffer(*buf);
+	*buf = nullptr;
+	cap = 0;
+#ifdef USE_CUDA
+	CUDA_ERR_CHK(cudaMalloc(buf, newCap));
+#else
+	*buf = new uint8_t[newCap];
+#endif
+	cap = newCap;
+}
+
+TereScene::~TereScene()
+{
+	for (size_t i = 0; i < rgbs.size(); ++i) {
+		ReleaseImage(i);
+	}
+
+	FreeBuffer(v);
+	FreeBuffer(f);
 }
 
 static void Copy(void *dst, const void *src, const size_t sz, bool fromcuda, bool tocuda)
@@ -58,21 +114,17 @@ static void Copy(void *dst, const void *src, const size_t sz, bool fromcuda, boo
 bool TereScene::UpdateGeometry(const float * _v, const size_t _szV, const int * _f,
 	const size_t _szF, bool _GPU)
 {
-	if (_szV > szVBuf) {
-		RETURN_ON_ERROR("Too many vertices");
+	// (re)allocate memory for vertices and faces
+	try {
+		if (_v) GrowBuffer(reinterpret_cast<void**>(&v), szVBuf, _szV);
+		if (_f) GrowBuffer(reinterpret_cast<void**>(&f), szFBuf, _szF);
 	}
-	if (_szF > szFBuf) {
-		RETURN_ON_ERROR("Too many faces");
+	catch (std::exception &e) {
+		RETURN_ON_ERROR(e.what());
 	}
-
-	// allocate memory for vertices and faces
 #ifdef USE_CUDA
-	if (_v && !v) CUDA_ERR_CHK(cudaMalloc(&v, szVBuf));
-	if (_f && !f) CUDA_ERR_CHK(cudaMalloc(&f, szFBuf));
 	GPU = true;
 #else
-	if (_v && !v) v = reinterpret_cast<float*>(new uint8_t[szVBuf]);
-	if (_f && !f) f = reinterpret_cast<int*>(new uint8_t[szFBuf]);
 	GPU = false;
 #endif
 
@@ -95,29 +147,111 @@ bool TereScene::UpdateGeometry(const float * _v, const size_t _szV, const int *
 	// glDrawElement.
 	dArray = (_f == nullptr);
 	dElement = !dArray;
+	dirtyGeometry = true;
+
+	return BuildLods() && BuildMeshlets();
+}
+
+bool TereScene::BuildLods()
+{
+	lodF.clear();
+	lods.clear();
+	if (!dElement) {
+		return true;
+	}
+
+	const size_t nIndices = szF / sizeof(int);
+	lods.push_back({ 0, nIndices, 0.f, 0, 0 });
+
+	// CUDA geometry never reaches the host
+	if (lodLevels < 2 || GPU) {
+		return true;
+	}
+
+	vector<size_t> targets;
+	for (size_t k = 1, target = nIndices; k < lodLevels; ++k) {
+		target = static_cast<size_t>(target / 3 * LOD_REDUCTION) * 3;
+		if (target < MIN_LOD_FACES * 3) break;
+		targets.push_back(target);
+	}
+
+	// levels are simplified one from the other in a single pass
+	vector<vector<int>> levels;
+	vector<float> errors;
+	try {
+		SimplifyMesh(v, szV / BYTES_PER_VERTEX, f, nIndices, targets, levels, errors);
+	}
+	catch (std::exception &e) {
+		RETURN_ON_ERROR("Failed to simplify geometry: %s", e.what());
+	}
+
+	// keep levels that got smaller
+	size_t first = nIndices;
+	for (size_t k = 0; k < levels.size(); ++k) {
+		if (levels[k].empty() || levels[k].size() >= lods.back().count) {
+			continue;
+		}
+		lods.push_back({ first, levels[k].size(), errors[k], 0, 0 });
+		lodF.insert(lodF.end(), levels[k].begin(), levels[k].end());
+		first += levels[k].size();
+	}
 
 	return true;
 }
 
-bool TereScene::UpdateImage(const size_t _id, const uint8_t * _data, const int _w,
-	const int _h)
+bool TereScene::BuildMeshlets()
 {
-	if (_id < 0 || _id >= nCams) {
-		RETURN_ON_ERROR("Invalid camera index");
+	meshlets.clear();
+
+	// CUDA geometry never reaches the host
+	if (!dElement || GPU) {
+		return true;
 	}
-	if (!_data) {
-		RETURN_ON_ERROR("data is NULL");
+
+	try {
+		for (MeshLod &lod : lods) {
+			int *faces = lod.first == 0 ? f : &lodF[lod.first - szF / sizeof(int)];
+			lod.firstMeshlet = meshlets.size();
+			::BuildMeshlets(v, faces, lod.count, lod.first, meshlets);
+			lod.nMeshlets = meshlets.size() - lod.firstMeshlet;
+		}
+	}
+	catch (std::exception &e) {
+		RETURN_ON_ERROR("Failed to build meshlets: %s", e.what());
 	}
-	if ((width != 0 && _w != width) || _w < 1) {
-		RETURN_ON_ERROR("Invalid width: %d", _w);
+
+	return true;
+}
+
+bool TereScene::CheckImage(const size_t id, const int w, const int h)
+{
+	if (id >= nCams) {
+		RETURN_ON_ERROR("Invalid camera index");
 	}
-	if ((height != 0 && _h != height) || _h < 1) {
-		RETURN_ON_ERROR("Invalid height: %d", _h);
+	if ((width != 0 && w != width) || w < 1) {
+		RETURN_ON_ERROR("Invalid width: %d", w);
+	}
+	if ((height != 0 && h != height) || h < 1) {
+		RETURN_ON_ERROR("Invalid height: %d", h);
 	}
 
 	if (width == 0 || height == 0) {
-		width = _w;
-		height = _h;
+		width = w;
+		height = h;
+	}
+
+	return true;
+}
+
+bool TereScene::ReserveImage(const size_t _id, const int _w, const int _h)
+{
+	if (!CheckImage(_id, _w, _h)) {
+		return false;
+	}
+
+	// never write into a buffer the scene does not own
+	if (rgbs[_id] != nullptr && !ownImages[_id]) {
+		ReleaseImage(_id);
 	}
 
 	// allocate image memory
@@ -129,6 +263,92 @@ bool TereScene::UpdateImage(const size_t _id, const uint8_t * _data, const int _
 		rgbs[_id] = new uint8_t[_w * _h * 3]();
 		GPU = false;
 #endif 
+		ownImages[_id] = true;
+	}
+
+	return true;
+}
+
+bool TereScene::TakeImage(const size_t _id, uint8_t *_data, const int _w,
+	const int _h)
+{
+	if (!_data) {
+		RETURN_ON_ERROR("data is NULL");
+	}
+	if (!CheckImage(_id, _w, _h)) {
+		return false;
+	}
+
+	ReleaseImage(_id);
+	rgbs[_id] = _data;
+	ownImages[_id] = true;
+#ifdef USE_CUDA
+	GPU = true;
+#else
+	GPU = false;
+#endif
+	dirtyImages[_id] = true;
+	return true;
+}
+
+bool TereScene::AdoptImage(const size_t _id, uint8_t *_data, const int _w,
+	const int _h, ReleaseImageFunc _release, void *_user)
+{
+	if (!_data) {
+		RETURN_ON_ERROR("data is NULL");
+	}
+	if (!CheckImage(_id, _w, _h)) {
+		return false;
+	}
+
+	if (rgbs[_id] != _data) {
+		ReleaseImage(_id);
+	}
+
+	rgbs[_id] = _data;
+	ownImages[_id] = false;
+	releaseFuncs[_id] = _release;
+	releaseData[_id] = _user;
+#ifdef USE_CUDA
+	GPU = true;
+#else
+	GPU = false;
+#endif
+	dirtyImages[_id] = true;
+	return true;
+}
+
+void TereScene::ReleaseImage(const size_t id)
+{
+	if (rgbs[id] == nullptr) {
+		return;
+	}
+
+	if (ownImages[id]) {
+#ifdef USE_CUDA
+		cudaFree(rgbs[id]);
+#else
+		delete[] rgbs[id];
+#endif
+	}
+	else if (releaseFuncs[id]) {
+		releaseFuncs[id](rgbs[id], releaseData[id]);
+	}
+
+	rgbs[id] = nullptr;
+	ownImages[id] = false;
+	releaseFuncs[id] = nullptr;
+	releaseData[id] = nullptr;
+}
+
+bool TereScene::UpdateImage(const size_t _id, const uint8_t * _data, const int _w,
+	const int _h)
+{
+	if (!_data) {
+		RETURN_ON_ERROR("data is NULL");
+	}
+	if (!ReserveImage(_id, _w, _h)) {
+		return false;
 	}
 
 	// copy image
@@ -138,6 +358,8 @@ bool TereScene::UpdateImage(const size_t _id, const uint8_t * _data, const int _
 	catch (std::exception &e) {
 		RETURN_ON_ERROR(e.what());
 	}
+
+	dirtyImages[_id] = true;
 	return true;
 }
 
@@ -150,25 +372,12 @@ bool TereScene::UpdateCamera(const size_t id, const array<float, 9> &K,
 
 	intrins[id] = Intrinsic(K.data());
 	extrins[id] = Extrinsic(M.data(), w2c, yIsUp);
+	dirtyCameras[id] = true;
 	return true;
 }
 
 #define TEST(t) { if (!(t)) RETURN_ON_ERROR(#t); }
 
-static float CalculateRadius(const vector<Extrinsic> &extrins, const array<float, 3> &center)
-{
-	vector<float> dists(extrins.size());
-	glm::vec3 c(center[0], center[1], center[2]);
-
-	for (size_t i = 0; i < extrins.size(); ++i) {
-		glm::vec3 pcam = extrins[i].Pos();
-		dists[i] = glm::length(pcam - c);
-	}
-
-	float radius = std::accumulate(dists.cbegin(), dists.cend(), 0.f) / dists.size();
-	return radius;
-}
-
 static void FindBBCenterAndRadius(const float *v, const size_t szV, glm::vec3 &center, float &radius)
 {
 	float minx = 0.f, maxx = 0.f, miny = 0.f, maxy = 0.f, minz = 0.f, maxz = 0.f;
@@ -188,25 +397,25 @@ static void FindBBCenterAndRadius(const float *v, const size_t szV, glm::vec3 &c
 	radius = glm::length(center - glm::vec3(minx, miny, minz));
 }
 
-static float CalcCameraRadius(const vector<Extrinsic> &extrins, const glm::vec3 center)
+static float CalcCameraRadius(const vector<glm::vec3> &positions, const glm::vec3 center)
 {
 	float distAdds = 0.f;
 
-	for (size_t i = 0; i < extrins.size(); ++i) {
-		distAdds += glm::length(center - extrins[i].Pos());
+	for (size_t i = 0; i < positions.size(); ++i) {
+		distAdds += glm::length(center - positions[i]);
 	}
 
-	return distAdds / extrins.size();
+	return distAdds / positions.size();
 }
 
-static void CalcCameraToCenter(const vector<Extrinsic> &extrins, const glm::vec3 &center,
+static void CalcCameraToCenter(const vector<glm::vec3> &positions, const glm::vec3 &center,
 	float &near, float &far)
 {
 	near = FLT_MAX;
 	far = FLT_MIN;
 
-	for (size_t i = 0; i < extrins.size(); ++i) {
-		float len = glm::length(center - extrins[i].Pos());
+	for (size_t i = 0; i < positions.size(); ++i) {
+		float len = glm::length(center - positions[i]);
 		near = near > len ? len : near;
 		far = far < len ? len : far;
 	}
@@ -229,18 +438,42 @@ bool TereScene::Configure()
 	// trivial tests
 	for (auto intrin : intrins) TEST(abs(intrin.cx) > 1e-5);		
 
-	for (auto rgb : rgbs) TEST(rgb);
+	// released images only live in the renderer's textures
+	for (size_t i = 0; i < nCams; ++i) TEST(rgbs[i] || uploadedImages[i]);
 	TEST(width > 0 && height > 0);
 
 	// Calculate mesh bounding box and near/far range
-	float boxRadius = 0.f;
 	float n, f;
 		
+	const bool newCameras = rig.positions.size() != nCams ||
+		std::find(dirtyCameras.begin(), dirtyCameras.end(), true) != dirtyCameras.end();
+	if (newCameras) {
+		rig.UpdateCameras(extrins);
+	}
+		
 	FindBBCenterAndRadius(v, szV, center, boxRadius);
-	radius = CalcCameraRadius(extrins, center);
-	CalcCameraToCenter(extrins, center, n, f);
+	if (newCameras || center != rig.center) {
+		rig.UpdateDirections(center);
+	}
+
+	radius = CalcCameraRadius(rig.positions, center);
+	CalcCameraToCenter(rig.positions, center, n, f);
+
+	const float oldNear = glnear, oldFar = glfar;
 	glnear = std::max(0.01f, n - boxRadius);
 	glfar = f + boxRadius;
+	if (newCameras || glnear != oldNear || glfar != oldFar) {
+		rig.UpdateProjections(intrins, extrins, glnear, glfar, width, height);
+	}
 
 	return true;
 }
+
+void TereScene::MarkDirty()
+{
+	dirtyGeometry = true;
+	for (size_t i = 0; i < rgbs.size(); ++i) {
+		dirtyImages[i] = (rgbs[i] != nullptr);
+	}
+	std::fill(dirtyCameras.begin(), dirtyCameras.end(), true);
+}
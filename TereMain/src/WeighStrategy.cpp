@@ -2,19 +2,16 @@
 #include <algorithm>
 #include "Strategy.h"
 
-DefaultWeighStrategy::DefaultWeighStrategy(const glm::vec3 &center)
-	: WeighStrategy(),
-	_center(center)
+DefaultWeighStrategy::DefaultWeighStrategy()
+	: WeighStrategy()
 {}
 
-vector<float> DefaultWeighStrategy::Weigh(const vector<Extrinsic> &ref,
+vector<float> DefaultWeighStrategy::Weigh(const CameraRig &rig,
 	const Extrinsic &rcam, const vector<size_t> &indices)
 {
 	const size_t nInterp = indices.size();
 	vector<float> weights(nInterp);
-	const Extrinsic rEx(rcam);
-	const glm::vec3 &rpos = rEx.Pos();
-	const glm::vec3 &p2r = glm::normalize(rpos - _center);
+	const glm::vec3 &p2r = glm::normalize(rcam.Pos() - rig.center);
 
 	if (nInterp == 0) {
 		return vector<float>();
@@ -23,9 +20,7 @@ vector<float> DefaultWeighStrategy::Weigh(const vector<Extrinsic> &ref,
 	for (size_t i = 0; i < nInterp; ++i) {
 		// calculate cosine distances between rendering camera and 
 		// i-th selected reference camera
-		const Extrinsic refEx(ref[indices[i]]);
-		const glm::vec3 &refPos = refEx.Pos();
-		const float dis = glm::dot(p2r, glm::normalize(refPos - _center));
+		const float dis = glm::dot(p2r, rig.directions[indices[i]]);
 
 		// assign weights according to cosine distances
 		const float weight = 1.f / (1.f + 1e-5f - dis);
@@ -0,0 +1,62 @@
+#include "Worker.h"
+
+using namespace std;
+
+Worker::Worker()
+	: _quit(false)
+{
+	_thread = thread(&Worker::Run, this);
+}
+
+Worker::~Worker()
+{
+	{
+		unique_lock<mutex> lock(_mutex);
+		_cond.wait(lock, [this] { return !_job; });
+		_quit = true;
+	}
+	_cond.notify_all();
+	_thread.join();
+}
+
+void Worker::Submit(function<void()> job)
+{
+	{
+		unique_lock<mutex> lock(_mutex);
+		_cond.wait(lock, [this] { return !_job; });
+		_job = std::move(job);
+	}
+	_cond.notify_all();
+}
+
+void Worker::Wait()
+{
+	unique_lock<mutex> lock(_mutex);
+	_cond.wait(lock, [this] { return !_job; });
+}
+
+bool Worker::Busy()
+{
+	unique_lock<mutex> lock(_mutex);
+	return static_cast<bool>(_job);
+}
+
+void Worker::Run()
+{
+	unique_lock<mutex> lock(_mutex);
+
+	while (true) {
+		_cond.wait(lock, [this] { return _job || _quit; });
+		if (_quit) {
+			return;
+		}
+
+		// run unlocked, the job stays set until it has finished
+		lock.unlock();
+		_job();
+		lock.lock();
+
+		_job = nullptr;
+		_cond.notify_all();
+	}
+}
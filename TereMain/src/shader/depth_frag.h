@@ -2,10 +2,11 @@
 #define DEPTH_FRAG_H
 
 #include "Platform.h"
+#include "Const.h"
 
 const char *DEPTH_FS =
 "//dpfs\n"
-#if defined PLATFORM_WIN || defined PLATFORM_OSX
+#if defined PLATFORM_WIN || defined PLATFORM_OSX || defined PLATFORM_LINUX
 "#version 330 \n"
 #else
 "#version 300 es\n"
@@ -14,13 +15,20 @@ const char *DEPTH_FS =
 "precision highp int;\n"
 
 "out vec4 color;\n"
-"in vec3 vertex_position;\n"
 "in float vDepth;\n"
 
-"uniform mat4 VP;\n"
 "uniform float near;\n"
 "uniform float far;\n"
+#ifdef USE_TEXTURE_ARRAY
+// clip position in the reference camera, whose rgb is in *layer*
+"in vec4 ref_position;\n"
+"flat in float layer;\n"
+"uniform highp sampler2DArray RGBA;\n"
+#else
+"in vec3 vertex_position;\n"
+"uniform mat4 VP;\n"
 "uniform sampler2D RGBA;\n"
+#endif
 
 "float LinearizeDepth(float depth)\n"
 "{\n"
@@ -29,18 +37,43 @@ const char *DEPTH_FS =
 "	return (2.0 * near * far) / (far + near - z * (far - near));\n"
 "}\n"
 
+#if defined USE_TEXTURE_ARRAY && !(defined PLATFORM_WIN || defined PLATFORM_OSX || defined PLATFORM_LINUX)
+// without clip distances, fragments past the camera's tile are dropped here
+"#define CLIP_TILE() if (any(greaterThan(abs(ref_position.xy), vec2(ref_position.w)))) discard\n"
+#else
+"#define CLIP_TILE()\n"
+#endif
+
+#ifdef USE_DEPTH_MAP
+// linear depth goes straight to the (16 bits) depth attachment
 "void main()\n"
 "{\n"
+"	CLIP_TILE();\n"
+"	gl_FragDepth = (LinearizeDepth(gl_FragCoord.z) - near) / (far - near);\n"
+"}\n";
+#else
+"void main()\n"
+"{\n"
+"	CLIP_TILE();\n"
 	// equally divide the length between near and far (256 pieces)
 "	float depth = (LinearizeDepth(gl_FragCoord.z) - near) / (far - near);\n"
 
+#ifdef USE_TEXTURE_ARRAY
+"	vec4 ndc = ref_position / ref_position.w;\n"
+#else
 "	vec4 ndc = VP * vec4(vertex_position, 1.0);\n"
 "	ndc = ndc / ndc.w;\n"
+#endif
 "	vec2 tex_coord = (ndc.xy + vec2(1.0, 1.0)) / vec2(2.0, 2.0);\n"
 	// image is in top-down format
 "	tex_coord.y = 1.f - tex_coord.y;	\n"
+#ifdef USE_TEXTURE_ARRAY
+"	vec4 rgba = texture(RGBA, vec3(tex_coord, layer)).rgba;	\n"
+#else
 "	vec4 rgba = texture(RGBA, tex_coord).rgba;	\n"
+#endif
 "	color = vec4(rgba.rgb, depth);\n"
 "}\n";
+#endif /* USE_DEPTH_MAP */
 
 #endif
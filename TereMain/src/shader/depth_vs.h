@@ -2,10 +2,11 @@
 #define DEPTH_VS_H
 
 #include "Platform.h"
+#include "Const.h"
 
 const char *DEPTH_VS =
 "//dpvs\n"
-#if defined PLATFORM_WIN || defined PLATFORM_OSX
+#if defined PLATFORM_WIN || defined PLATFORM_OSX || defined PLATFORM_LINUX
 "#version 330 \n"
 #else
 "#version 300 es\n"
@@ -13,6 +14,37 @@ const char *DEPTH_VS =
 
 "layout(location = 0) in vec3 vertexPosition_modelspace;\n"
 
+#ifdef USE_TEXTURE_ARRAY
+"const int MAX_BAKE_BATCH = "
+STR_MAX_BAKE_BATCH(MAX_BAKE_BATCH)"; \n"
+// every instance draws one reference camera into its tile of the atlas
+"layout(std140) uniform BakeCameras { \n"
+"	highp mat4 bakeVP[MAX_BAKE_BATCH]; \n"
+	// xy: tile center in atlas NDC, z: layer of the camera
+"	highp vec4 bakeTiles[MAX_BAKE_BATCH]; \n"
+"}; \n"
+// size of a tile in atlas NDC
+"uniform vec2 tileScale;\n"
+
+"out vec4 ref_position;\n"
+"flat out float layer;\n"
+
+"void main()\n"
+"{\n"
+"	ref_position = bakeVP[gl_InstanceID] * vec4(vertexPosition_modelspace, 1.0);\n"
+"	vec4 tile = bakeTiles[gl_InstanceID];\n"
+"	gl_Position = vec4(ref_position.xy * tileScale + tile.xy * ref_position.w, \n"
+"		ref_position.zw);\n"
+"	layer = tile.z;\n"
+#if defined PLATFORM_WIN || defined PLATFORM_OSX || defined PLATFORM_LINUX
+	// nothing spills into neighboring tiles
+"	gl_ClipDistance[0] = ref_position.w + ref_position.x;\n"
+"	gl_ClipDistance[1] = ref_position.w - ref_position.x;\n"
+"	gl_ClipDistance[2] = ref_position.w + ref_position.y;\n"
+"	gl_ClipDistance[3] = ref_position.w - ref_position.y;\n"
+#endif
+"}\n";
+#else
 "uniform mat4 VP;\n"
 
 "out vec3 vertex_position;\n"
@@ -22,5 +54,6 @@ const char *DEPTH_VS =
 "	gl_Position = VP * vec4(vertexPosition_modelspace, 1.0);\n"
 "	vertex_position = vertexPosition_modelspace;\n"
 "}\n";
+#endif /* USE_TEXTURE_ARRAY */
 
 #endif
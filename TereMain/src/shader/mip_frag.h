@@ -0,0 +1,71 @@
+#ifndef MIP_FRAG_H
+#define MIP_FRAG_H
+
+#include "Platform.h"
+#include "Const.h"
+
+// Downsample one level of a reference texture into the next one. Color is 
+// averaged over the texels covered by geometry, depth keeps the nearest 
+// surface of the 2x2 footprint so that a coarse level never claims a 
+// fragment is visible when it is occluded.
+const char *MIP_FS =
+"//mpfs\n"
+#if defined PLATFORM_WIN || defined PLATFORM_OSX || defined PLATFORM_LINUX
+"#version 330 \n"
+#else
+"#version 300 es\n"
+#endif
+"precision highp float;\n"
+"precision highp int;\n"
+
+"out vec4 color;\n"
+
+#ifdef USE_TEXTURE_ARRAY
+"uniform highp sampler2DArray source;\n"
+"uniform int layer;\n"
+#else
+"uniform highp sampler2D source;\n"
+#endif
+"uniform int level;\n"		// level read from
+#ifdef USE_DEPTH_MAP
+"uniform bool depthPass;\n"	// source is a depth map
+#endif
+
+"vec4 Fetch(ivec2 p, ivec2 size)\n"
+"{\n"
+#ifdef USE_TEXTURE_ARRAY
+"	return texelFetch(source, ivec3(min(p, size - 1), layer), level);\n"
+#else
+"	return texelFetch(source, min(p, size - 1), level);\n"
+#endif
+"}\n"
+
+"void main()\n"
+"{\n"
+"	ivec2 size = textureSize(source, level).xy;\n"
+"	ivec2 p = ivec2(gl_FragCoord.xy) * 2;\n"
+"	vec4 s0 = Fetch(p, size);\n"
+"	vec4 s1 = Fetch(p + ivec2(1, 0), size);\n"
+"	vec4 s2 = Fetch(p + ivec2(0, 1), size);\n"
+"	vec4 s3 = Fetch(p + ivec2(1, 1), size);\n"
+
+"	color = (s0 + s1 + s2 + s3) * 0.25;\n"
+#ifdef USE_DEPTH_MAP
+	// no geometry is 1.0, the farthest depth
+"	gl_FragDepth = depthPass ? min(min(s0.r, s1.r), min(s2.r, s3.r)) : 1.0;\n"
+#else
+	// no geometry is 0.0 and its color black, neither is averaged in
+"	vec4 d = vec4(s0.a, s1.a, s2.a, s3.a);\n"
+"	vec4 covered = vec4(greaterThan(d, vec4(0.0)));\n"
+"	float n = dot(covered, vec4(1.0));\n"
+"	if (n > 0.0) {\n"
+"		color.rgb = (s0.rgb * covered.x + s1.rgb * covered.y + \n"
+"			s2.rgb * covered.z + s3.rgb * covered.w) / n;\n"
+"	}\n"
+"	d = mix(vec4(2.0), d, covered);\n"
+"	float nearest = min(min(d.x, d.y), min(d.z, d.w));\n"
+"	color.a = nearest > 1.0 ? 0.0 : nearest;\n"
+#endif
+"}\n";
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef MIP_VS_H
+#define MIP_VS_H
+
+#include "Platform.h"
+
+const char *MIP_VS =
+"//mpvs\n"
+#if defined PLATFORM_WIN || defined PLATFORM_OSX || defined PLATFORM_LINUX
+"#version 330 \n"
+#else
+"#version 300 es\n"
+#endif
+
+// a single triangle covering the viewport, no vertex attributes needed
+"void main()\n"
+"{\n"
+"	vec2 p = vec2(float((gl_VertexID & 1) << 2), float((gl_VertexID & 2) << 1));\n"
+"	gl_Position = vec4(p - 1.0, 0.0, 1.0);\n"
+"}\n";
+
+#endif
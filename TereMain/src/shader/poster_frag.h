@@ -5,7 +5,7 @@
 
 const char *poster_frag_code =
 "//posf\n"
-#if defined PLATFORM_WIN || defined PLATFORM_OSX
+#if defined PLATFORM_WIN || defined PLATFORM_OSX || defined PLATFORM_LINUX
 "#version 330 \n"
 #else
 "#version 300 es\n"
@@ -19,10 +19,20 @@ const char *poster_frag_code =
 
 // texture sampler
 "uniform sampler2D image;	\n"
+// used part of image, the rest is left from larger frames
+"uniform vec2 region;		\n"
+
+// background (a color or an image)
+"uniform bool  monochromatic;   \n"
+"uniform vec3 bgColor;			\n"
+"uniform sampler2D bgTexture;   \n"
 
 "void main()			\n"
 "{						\n"
-"	fColor = texture(image, vTexCoord);	\n"
+"	vec2 halfTexel = 0.5 / vec2(textureSize(image, 0));	\n"
+"	vec4 _fgColor = texture(image, min(vTexCoord * region, region - halfTexel));	\n"
+"	vec4 _bgColor = ( monochromatic ? vec4(bgColor, 1.0f) : texture(bgTexture, vec2(vTexCoord.x, 1.f-vTexCoord.y)) );   \n"
+"	fColor = mix(_bgColor, _fgColor, _fgColor.a);	\n"
 "}						\n";
 
 #endif
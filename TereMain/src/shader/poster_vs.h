@@ -5,7 +5,7 @@
 
 const char *poster_vs_code =
 "//posv\n"
-#if defined PLATFORM_WIN ||defined PLATFORM_OSX
+#if defined PLATFORM_WIN || defined PLATFORM_OSX || defined PLATFORM_LINUX
 "#version 330 \n"
 #else
 "#version 300 es\n"
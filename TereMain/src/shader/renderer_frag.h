@@ -4,13 +4,20 @@
 #include "Platform.h"
 #include "Const.h"
 
-#if MAX_NUM_INTERP > 20
-#error MAX_NUM_INTERP must not be larger than 20
+// Sampler arrays are limited by texture units. With USE_TEXTURE_ARRAY the 
+// light field is a single sampler and only uniform space bounds the count.
+#if MAX_NUM_INTERP > 20 && !defined USE_TEXTURE_ARRAY
+#error MAX_NUM_INTERP must not be larger than 20 (unless USE_TEXTURE_ARRAY)
+#endif
+
+// InterpCameras must fit in the minimum GL_MAX_UNIFORM_BLOCK_SIZE (16KB)
+#if MAX_NUM_INTERP > 256
+#error MAX_NUM_INTERP must not be larger than 256
 #endif
 
 const char *SCENE_FS =
 "//snfs\n"
-#if defined PLATFORM_WIN || defined PLATFORM_OSX
+#if defined PLATFORM_WIN || defined PLATFORM_OSX || defined PLATFORM_LINUX
 "#version 330 \n"
 #else
 "#version 300 es\n"
@@ -23,17 +30,34 @@ const char *SCENE_FS =
 
 "const int MAX_NUM_INTERP = "
 STR_MAX_NUM_INTERP(MAX_NUM_INTERP)"; \n"
+#ifdef USE_DEPTH_MAP
+// 16 bits depth is not quantized to 1/255, but a coarser depth map has 
+// more error along slopes
+"const float DEPTH_MAP_EPS = 0.5 / (255.0 * " STR_DEPTH_MAP_SCALE(DEPTH_MAP_SCALE) "); \n"
+#endif
+#ifdef PROJECT_PER_VERTEX
+"in highp vec4[MAX_NUM_INTERP] interp_position; \n"
+#else
 "in highp vec4 vertex_location;   \n"
-"in highp float[MAX_NUM_INTERP] depthNoOccul; \n"
+#endif
 "in highp vec3 vColor; \n"
 
 "uniform highp int[MAX_NUM_INTERP] interpIndices; \n"
 "uniform highp float[MAX_NUM_INTERP] interpWeights; \n"
 "uniform highp int nInterps; \n"
-"uniform highp sampler2D ref_cam_VP;\n"
-"uniform highp sampler2D ref_cam_V;\n"
-"uniform int N_REF_CAMERAS;\n"
+"layout(std140) uniform InterpCameras { \n"
+"	highp mat4 interpVP[MAX_NUM_INTERP]; \n"
+"}; \n"
+#ifdef USE_TEXTURE_ARRAY
+"uniform mediump sampler2DArray lightField; \n"
+#else
 "uniform mediump sampler2D lightField[MAX_NUM_INTERP]; \n"
+#endif
+#ifdef USE_DEPTH_MAP
+"uniform highp sampler2DArray depthMap; \n"
+"uniform highp float depthMaxLod; \n"
+#endif
+"uniform highp float maxLod; \n"
 "uniform highp float near;\n"
 "uniform highp float far;\n"
 
@@ -41,27 +65,59 @@ STR_MAX_NUM_INTERP(MAX_NUM_INTERP)"; \n"
 
 "vec4 missColor = vec4(255, 87, 155, 255) / 255.0;\n"
 
-// calculate projected (u,v) of fragment
-"vec2 CalcTexCoordRoutine(int cam_id) \n"
+// clip coordinates of fragment in i-th interpolation camera
+#ifdef PROJECT_PER_VERTEX
+"#define INTERP_POSITION(i) interp_position[i]\n"
+#else
+"#define INTERP_POSITION(i) (interpVP[i] * vertex_location)\n"
+#endif
+
+// calculate projected (u,v) of fragment in a camera from its clip coordinates
+"vec2 CalcTexCoordRoutine(vec4 clip_coord) \n"
 "{\n"
-"	vec4 ndc_coord = mat4(texture(ref_cam_VP, vec2(float(8*cam_id + 1) / float(8*N_REF_CAMERAS), 0.0)), \n"
-"		texture(ref_cam_VP, vec2(float(8*cam_id + 3) / float(8*N_REF_CAMERAS), 0.0)),\n"
-"		texture(ref_cam_VP, vec2(float(8*cam_id + 5) / float(8*N_REF_CAMERAS), 0.0)),\n"
-"		texture(ref_cam_VP, vec2(float(8*cam_id + 7) / float(8*N_REF_CAMERAS), 0.0))) * vertex_location;\n"
-"	ndc_coord /= ndc_coord.w;\n"
-"	vec2 tex_coord = (ndc_coord.xy + vec2(1.0, 1.0)) / vec2(2.0, 2.0);\n"
+"	vec2 ndc_coord = clip_coord.xy / clip_coord.w;\n"
+"	vec2 tex_coord = (ndc_coord + vec2(1.0, 1.0)) / vec2(2.0, 2.0);\n"
 "	return tex_coord;\n"
 "}\n"
 
+// calculate depth of fragment in a camera from its clip coordinates 
+// (ignoring occlusion). Projections keep the distance along the view axis in w.
+"float CalcDepthRoutine(vec4 clip_coord) \n"
+"{\n"
+"	return (clip_coord.w - near) / (far - near);\n"
+"}\n"
+
+// mip level whose texels match the fragment's footprint in a texture of 
+// *size* texels. Color and depth of a camera are read from the same level.
+"float MipLevel(vec2 coord, vec2 size, float maxLevel) \n"
+"{\n"
+"	vec2 dx = dFdx(coord) * size;\n"
+"	vec2 dy = dFdy(coord) * size;\n"
+"	return clamp(0.5 * log2(max(dot(dx, dx), dot(dy, dy))), 0.0, maxLevel);\n"
+"}\n"
+
+#ifdef USE_DEPTH_MAP
+// depth map is cleared to 1.0 where there is no geometry
+"bool DepthTest(float pixelDepth, float depthNoOccul, float EPS) \n"
+"{\n"
+"	return (pixelDepth < 1.f && abs(depthNoOccul - pixelDepth) <= EPS);\n"
+"}\n"
+#else
 "bool DepthTest(float pixelDepth, float depthNoOccul, float EPS) \n"
 "{\n"
 "	return (pixelDepth > 0.f && abs(depthNoOccul - pixelDepth) <= EPS);\n"
 "}\n"
+#endif
 
+#ifndef USE_TEXTURE_ARRAY
 "#define PROJECT(i) do { \\\n"
 "	if (nInterps >= i) {	\\\n"
-"		tex_coord = CalcTexCoordRoutine(interpIndices[i-1]);\\\n"
-"		pixels[i-1] = texture(lightField[i-1], vec2(tex_coord.x, tex_coord.y)).rgba;\\\n"
+"		clip_coord = INTERP_POSITION(i-1);\\\n"
+"		tex_coord = CalcTexCoordRoutine(clip_coord);\\\n"
+"		lod = MipLevel(tex_coord, lfSize, maxLod);\\\n"
+"		pixels[i-1] = textureLod(lightField[i-1], vec2(tex_coord.x, tex_coord.y), lod).rgba;\\\n"
+"		mipScale[i-1] = exp2(floor(lod + 0.5));\\\n"
+"		depthNoOccul[i-1] = CalcDepthRoutine(clip_coord);\\\n"
 "	} } while(false);	\n"
 
 // help macros for various MAX_NUM_INTERP
@@ -87,6 +143,7 @@ STR_MAX_NUM_INTERP(MAX_NUM_INTERP)"; \n"
 "#define REPEAT_PROJECT20() { REPEAT_PROJECT19(); PROJECT(20); }\n"
 "#define REPEAT_PROJECT() REPEAT_PROJECT"
 STR_MAX_NUM_INTERP(MAX_NUM_INTERP)"()\n"
+#endif
 
 /******************************************************
 * Do view-dependent texture blending. The number of reference cameras for
@@ -97,19 +154,58 @@ STR_MAX_NUM_INTERP(MAX_NUM_INTERP)"()\n"
 ******************************************************/
 "void main()\n"
 "{\n"
+#ifdef USE_DEPTH_MAP
+"	float	EPS				= DEPTH_MAP_EPS;\n"		// depth test threshold
+#else
 "	float	EPS				= 1.5 / 255.0;\n"		// depth test threshold
+#endif
 "	float	total_weight	= 0.0;\n"
 "   float	weight			= 0.0f;    \n"
 "   vec2	tex_coord		= vec2(0.0);  \n"
+"	vec4	clip_coord		= vec4(0.0);  \n"
 "	color					= vec4(0.0);      \n"
 "	vec4[MAX_NUM_INTERP] pixels;	\n"
+"	float[MAX_NUM_INTERP] mipScale;	\n"	// depth error grows with the level
+"	float[MAX_NUM_INTERP] depthNoOccul;	\n"
+"	float	lod				= 0.0;	\n"
+#ifdef USE_TEXTURE_ARRAY
+"	vec2	lfSize			= vec2(textureSize(lightField, 0).xy);	\n"
+#else
+"	vec2	lfSize			= vec2(textureSize(lightField[0], 0));	\n"
+#endif
+#ifdef USE_DEPTH_MAP
+"	vec2	depthSize		= vec2(textureSize(depthMap, 0).xy);	\n"
+#endif
 
 // fetch projected pixels
+#ifdef USE_TEXTURE_ARRAY
+"	for (int i = 0; i != nInterps; ++i) {\n"
+"		clip_coord = INTERP_POSITION(i);\n"
+"		tex_coord = CalcTexCoordRoutine(clip_coord);\n"
+"		lod = MipLevel(tex_coord, lfSize, maxLod);\n"
+		// camera index is the layer index
+#ifdef USE_DEPTH_MAP
+		// color is kept in top-down image format, depth outside of the image
+		// is invalid
+"		pixels[i].rgb = textureLod(lightField, vec3(tex_coord.x, 1.0 - tex_coord.y, float(interpIndices[i])), lod).rgb;\n"
+"		lod = MipLevel(tex_coord, depthSize, depthMaxLod);\n"
+"		pixels[i].w = textureLod(depthMap, vec3(tex_coord, float(interpIndices[i])), lod).r;\n"
+"		if (any(lessThan(tex_coord, vec2(0.0))) || any(greaterThan(tex_coord, vec2(1.0)))) {\n"
+"			pixels[i].w = 1.0;\n"
+"		}\n"
+#else
+"		pixels[i] = textureLod(lightField, vec3(tex_coord, float(interpIndices[i])), lod).rgba;\n"
+#endif
+"		mipScale[i] = exp2(floor(lod + 0.5));\n"
+"		depthNoOccul[i] = CalcDepthRoutine(clip_coord);\n"
+"	}\n"
+#else
 "	REPEAT_PROJECT();\n"
+#endif
 
 // Blend reference pixels
 "	for (int i = 0; i != nInterps; ++i) {\n"
-"		float _EPS = EPS * (1.f + float(i / 3));	\n"	// increment EPS gradually
+"		float _EPS = EPS * (1.f + float(i / 3)) * mipScale[i];	\n"	// increment EPS gradually
 "       weight = interpWeights[i]; \n"
 "		weight *= float(DepthTest(pixels[i].w, depthNoOccul[i], _EPS));	\n"	// false is 0
 "		total_weight += weight; \n"
@@ -55,8 +55,16 @@ LOCAL_SRC_FILES := ../../TereMain/src/ArcballUI.cpp \
 ../../TereMain/src/PlyUtility.cpp \
 ../../TereMain/src/tinyply.cpp \
 ../../TereMain/src/Poster.cpp \
+../../TereMain/src/Readback.cpp \
+../../TereMain/src/GpuTimer.cpp \
+../../TereMain/src/FrameClock.cpp \
+../../TereMain/src/KdTree.cpp \
+../../TereMain/src/CameraRig.cpp \
+../../TereMain/src/Worker.cpp \
+../../TereMain/src/ResolutionScaler.cpp \
+../../TereMain/src/MeshSimplifier.cpp \
+../../TereMain/src/Meshlet.cpp \
 ../../TereMain/src/RenderUtils.cpp \
-../../TereMain/src/TextureFuser.cpp \
 
 
 LOCAL_STATIC_LIBRARIES := jpeg webp cpufeatures